@@ -59,7 +59,8 @@ void analyze()
             {
                 word_count += 2;
             }
-            else if (NULL !=   match(indexed_args, token_buffer))
+            else if (NULL != match(indexed_args, token_buffer)
+                     || NULL != match(branch_args, token_buffer))
             {
                 word_count += 3;
             }
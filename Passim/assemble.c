@@ -50,6 +50,27 @@ void assemble()
     line_no = 0;    // reset line counter for error handler
     token_buffer[0] = '\00';
 
+    // a wide image announces itself to pmac with a header line
+    if (WIDE && 0 > fputs(".WIDE\n", dest))
+    {
+        finish("Cannot write to output file - FATAL", FAIL);
+    }
+
+    // '-c <label>' declares everything before the label as shared code
+    if (NULL != code_end)
+    {
+        symbol* end = match(labels, code_end);
+
+        if (NULL == end || 0 == end->value)
+        {
+            finish("Code end label not found or at zero", FAIL);
+        }
+        if (0 > fprintf(dest, ".CODE 0 %lx\n", (unsigned long) end->value - 1))
+        {
+            finish("Cannot write to output file - FATAL", FAIL);
+        }
+    }
+
     printf("   0: ");   // add line # for zeroth line
 
     while(!feof(source) && ! ferror(dest))
@@ -165,6 +186,31 @@ bool assemble_op()
             err_flag = false;
         }
     }
+    else if (match_sym(branch_args, &op_sym))
+    {
+        // a value or address to compare with, then the branch target
+        emit(op_sym ->value);
+        if (!assemble_address())
+        {
+            report_err("Value or address expected.");
+            eat_line();
+            err_flag = false;
+        }
+        else
+        {
+            get_token();
+            if (match_sym(labels, &label_sym))
+            {
+                emit(label_sym ->value);
+            }
+            else
+            {
+                report_err("Label expected.");
+                eat_line();
+                err_flag = false;
+            }
+        }
+    }
     else if (match_sym(indexed_args, &op_sym))
     {
         if(!assemble_address())
@@ -199,11 +245,12 @@ bool assemble_op()
 }
 
 
-/* emit() - write out the hex value for the opcode or address.
+/* emit() - write out the hex value for the opcode or address,
+   as four digits for the 16-bit machine or eight for the wide one.
 */
 void emit(WORD value)
 {
-    if (0 > fprintf(dest, "%04X\n", value))
+    if (0 > fprintf(dest, WIDE ? "%08X\n" : "%04X\n", value))
     {
         finish("Cannot write to output file - FATAL", FAIL);
     }
@@ -47,6 +47,7 @@ void finish(char* description, EXITTYPE result)
     if (NULL != source)      fclose(source);
     if (NULL != dest)        fclose(dest);
     if (NULL != listing)     fclose(listing);
+    if (NULL != symbols)     fclose(symbols);
     
     // empty the tables built during the run
     if (NULL != labels)      empty_table(labels);
@@ -54,5 +55,6 @@ void finish(char* description, EXITTYPE result)
     if (NULL != direct_args) empty_table(direct_args);
     if (NULL != opcodes)     empty_table(address_args);
     if (NULL != opcodes)     empty_table(indexed_args);
+    if (NULL != branch_args) empty_table(branch_args);
     exit(result);
 }
@@ -36,7 +36,7 @@ void init(int count, char *list[])
 void init_tables()
 {
     /* initialize the table pointers */
-    labels = opcodes = direct_args = address_args = indexed_args = NULL;
+    labels = opcodes = direct_args = address_args = indexed_args = branch_args = NULL;
 
     printf("loading tables:\n");
     /* initialize the opcode table */
@@ -51,6 +51,7 @@ void init_tables()
     insert(&opcodes, "PUSHP", 0x0008);
     insert(&opcodes, "PUSHZ", 0x0009);
     insert(&opcodes, "DUP",   0x000A);
+    insert(&direct_args,  "LOADL", 0x000B);
     insert(&address_args, "POPA", 0x0100);
     insert(&indexed_args, "POPI", 0x0101);
     insert(&opcodes, "POPR",  0x0102);
@@ -59,12 +60,24 @@ void init_tables()
     insert(&opcodes, "POPS",  0x0105);
     insert(&opcodes, "DROP",  0x0106);
     insert(&opcodes, "SWAP",  0x0107);
+    insert(&direct_args,  "STOREL", 0x0108);
     insert(&address_args, "BRA", 0x0200);
     insert(&indexed_args, "BRI", 0x0201);
     insert(&address_args, "BRZ", 0x0300);
     insert(&address_args, "BNZ", 0x0301);
+    insert(&branch_args,  "BEQ",  0x0302);
+    insert(&branch_args,  "BNE",  0x0303);
+    insert(&branch_args,  "BLT",  0x0304);
+    insert(&branch_args,  "BGE",  0x0305);
+    insert(&branch_args,  "BEQA", 0x0306);
+    insert(&branch_args,  "BNEA", 0x0307);
+    insert(&branch_args,  "BLTA", 0x0308);
+    insert(&branch_args,  "BGEA", 0x0309);
+    insert(&branch_args,  "DBNZ", 0x030A);
     insert(&address_args, "BSR", 0x0400);
     insert(&opcodes, "RTS",   0x0401);
+    insert(&direct_args,  "ENTER", 0x0402);
+    insert(&opcodes, "LEAVE", 0x0403);
     insert(&opcodes, "EQL",   0x0500);
     insert(&opcodes, "NEQ",   0x0501);
     insert(&opcodes, "LES",   0x0502);
@@ -79,17 +92,46 @@ void init_tables()
     insert(&opcodes, "DIV",   0x0900);
     insert(&opcodes, "MOD",   0x09F0);
     insert(&opcodes, "SHL",   0x0A00);
+    insert(&opcodes, "ROL",   0x0A01);
     insert(&opcodes, "SHR",   0x0B00);
+    insert(&opcodes, "ROR",   0x0B01);
     insert(&opcodes, "IOR",   0x0C00);
     insert(&opcodes, "XOR",   0x0D00);
     insert(&opcodes, "AND",   0x0E00);
     insert(&opcodes, "NOT",   0x0F00);
+    insert(&opcodes, "POPCNT", 0x0F01);
+    insert(&opcodes, "CLZ",   0x0F02);
+    insert(&opcodes, "CTZ",   0x0F03);
+    insert(&opcodes, "BSWAP", 0x0F04);
     insert(&opcodes, "IN",    0x1000);
     insert(&opcodes, "OUT",   0x2000);
+    insert(&opcodes, "DADD",  0x3000);
+    insert(&opcodes, "DSUB",  0x3001);
+    insert(&opcodes, "DMUL",  0x3002);
+    insert(&opcodes, "DCMP",  0x3003);
+    insert(&opcodes, "DSHL",  0x3004);
+    insert(&opcodes, "DSHR",  0x3005);
+    insert(&opcodes, "QMUL",  0x3100);
+    insert(&opcodes, "QDIV",  0x3101);
+    insert(&opcodes, "QSQRT", 0x3102);
+    insert(&opcodes, "QADD",  0x3103);
+    insert(&opcodes, "QSUB",  0x3104);
+    insert(&opcodes, "CAS",   0x4000);
+    insert(&opcodes, "AADD",  0x4001);
+    insert(&opcodes, "CPUID", 0x4002);
+    insert(&opcodes, "NCPU",  0x4003);
+    insert(&opcodes, "BARRIER", 0x4004);
+    insert(&direct_args,  "CALLN", 0x5000);
+    insert(&opcodes, "HEAP",  0x6000);
+    insert(&opcodes, "ALLOC", 0x6001);
+    insert(&opcodes, "FREE",  0x6002);
+    insert(&opcodes, "RESIZE", 0x6003);
 }
 
 void parse_args(int count, char *list[])
 {
+    int i;
+
     if (3 > count)
     {
         if (2 == count && (0 == strcmp("--symbols", list[1])))
@@ -105,11 +147,13 @@ void parse_args(int count, char *list[])
             print_table(indexed_args);
             printf("Addressed ops:\n");
             print_table(address_args);
+            printf("Compare and branch ops:\n");
+            print_table(branch_args);
             finish("Table complete.", SUCCEED);
         }
         else
         {
-            finish("Usage: <src> <dest> [-l <listing>]", FAIL);
+            finish("Usage: <src> <dest> [-l <listing>] [-y <symbolmap>] [-c <label>] [-w]", FAIL);
         }
     }
 
@@ -124,17 +168,37 @@ void parse_args(int count, char *list[])
         finish("Could not open object file", FAIL);
     }
 
-    if (5 == count && 0 == strcmp(list[3], "-l"))
+    LIST = false;
+    WIDE = false;
+    for (i = 3; i < count; i++)
     {
-        LIST = true;
-        if (NULL == (listing = fopen(list[4], "w")))
+        if (0 == strcmp(list[i], "-l") && (i + 1) < count)
         {
-            finish("Could not open object file", FAIL);
+            LIST = true;
+            if (NULL == (listing = fopen(list[++i], "w")))
+            {
+                finish("Could not open object file", FAIL);
+            }
+        }
+        else if (0 == strcmp(list[i], "-y") && (i + 1) < count)
+        {
+            if (NULL == (symbols = fopen(list[++i], "w")))
+            {
+                finish("Could not open symbol map", FAIL);
+            }
+        }
+        else if (0 == strcmp(list[i], "-c") && (i + 1) < count)
+        {
+            code_end = list[++i];
+        }
+        else if (0 == strcmp(list[i], "-w"))
+        {
+            WIDE = true;
+        }
+        else
+        {
+            finish("Usage: <src> <dest> [-l <listing>] [-y <symbolmap>] [-c <label>] [-w]", FAIL);
         }
-    }
-    else
-    {
-        LIST = false;
     }
 }
 
@@ -30,11 +30,14 @@
 
 /* globals */
 FILE *source, *dest, *listing;
+FILE *symbols = NULL;   /* symbol map for pmac */
 bool LIST;   /* listing flag */
+bool WIDE;   /* 32-bit target flag */
+char* code_end = NULL;   /* label ending the shared code, from '-c' */
 unsigned long counter;  /* position counter */
 
 /* tables */
-symtable labels, opcodes, direct_args, address_args, indexed_args;
+symtable labels, opcodes, direct_args, address_args, indexed_args, branch_args;
 
 /* main() - driver program for the assembler
    - Reads in the shell args, which are passed to init() for parsing.
@@ -56,6 +59,10 @@ int main(int argc, char *argv[])
         fputs("Symbol Table: \n---------------------------------\n", listing);
     }
     print_table(labels);
+    if (NULL != symbols)
+    {
+        write_table(labels, symbols);
+    }
     LIST = false;  // only print source listing in first pass
     printf("\nPass two...\n");
     assemble();    // pass two - turn instructions to opcodes
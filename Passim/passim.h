@@ -25,11 +25,14 @@
 #include <stdint.h>
 #include <stdbool.h>
 
-typedef uint16_t WORD;
+typedef uint32_t WORD;   // wide enough for either machine width
 
 /* globals */
 extern FILE *source, *dest, *listing;
+extern FILE *symbols;   // symbol map for pmac, from '-y'
 extern bool LIST;   // listing flag 
+extern bool WIDE;   // assemble for the 32-bit machine
+extern char* code_end;   // label ending the shared code, from '-c'
 extern unsigned long counter;  // position counter 
 
 /* function prototypes */
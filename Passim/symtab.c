@@ -125,6 +125,20 @@ void print_table(symtable table)
 }
 
 
+/* write_table() - one symbol to a line, its value in hex then its
+   name, as pmac reads a symbol map */
+void write_table(symtable table, FILE* out)
+{
+    symbol *curr = (symbol *) table;
+
+    while (NULL != curr)
+    {
+        fprintf(out, "%x %s\n", curr ->value, curr ->name);
+        curr = curr ->next;
+    }
+}
+
+
 void empty_table(symtable table)
 {
     symbol *curr, *next;
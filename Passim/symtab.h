@@ -35,7 +35,7 @@ typedef struct sym
 typedef symbol* symtable;
 
 /* global tables */
-extern symtable tokens, labels, opcodes, direct_args, address_args, indexed_args;
+extern symtable tokens, labels, opcodes, direct_args, address_args, indexed_args, branch_args;
 
 /* symbol table functions */
 void insert(symtable* table, char* name, WORD value);
@@ -43,5 +43,6 @@ symbol* match(symtable table, char* name);
 void empty_table(symtable table);
 void destroy_symbol(symbol* sym);
 void print_table(symtable table);
+void write_table(symtable table, FILE* out);
 
 #endif
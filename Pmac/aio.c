@@ -0,0 +1,438 @@
+/* aio.c - asynchronous port I/O for batches of pmac machines.
+ * 'pmac -a <jobfile>' runs several machines on one host thread. Each
+ * machine is a coroutine; when it reads or writes its TTY or FDD, the
+ * request is submitted to an io_uring and the machine is suspended
+ * until the completion arrives, so that the other machines can run
+ * while the I/O is in flight. Machines are not preempted otherwise.
+ *
+ * Each line of the job file names one machine:
+ *     <program> <diskimg> [<tty input> [<tty output>]]
+ * with the TTY defaulting to the standard input and output.
+ *
+ * version 00.01.00
+ * Copyright (C) 2011  Joseph Osako
+ * This file is part of Pmac-Passim.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <ucontext.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include "pmac.h"
+#include "aio.h"
+#include "stats.h"
+
+#define MAX_JOBS    256
+#define JOB_STACK   (256 * 1024)
+#define TTY_BUFFER  4096
+
+typedef struct
+{
+    char name[256];
+    MACHINE machine;
+    ucontext_t context;
+    void* stack;
+    int tty_in, tty_out, disk;
+    char in_buffer[TTY_BUFFER];
+    long in_pos, in_length;
+    char out_buffer[TTY_BUFFER];
+    long out_length;
+    long io_result;     // result of the last completed request
+    uint64_t retired;   // instructions retired in earlier time slices
+    bool waiting;       // a request is in flight
+    bool done;
+    EXITTYPE result;
+} JOB;
+
+static JOB* jobs[MAX_JOBS];
+static int job_count = 0;
+static JOB* current = NULL;
+static ucontext_t scheduler;
+static uint64_t resumed_at;     // the thread's retired count when current resumed
+
+/* the submission and completion rings */
+static int ring_fd = -1;
+static unsigned *sq_tail, *sq_mask, *sq_array;
+static unsigned *cq_head, *cq_tail, *cq_mask;
+static struct io_uring_sqe* sqes;
+static struct io_uring_cqe* cqes;
+static unsigned to_submit = 0;
+
+static void load_jobs(char* jobfile);
+static void ring_init(unsigned entries);
+static long request(int opcode, int fd, void* buffer, long length, off_t offset);
+static void enter(unsigned wait);
+static void reap(void);
+static void job_main(void);
+
+
+/* aio_run() - load every machine in the job file and run them all
+   to completion. Exits with FAIL if any of them failed.
+*/
+void aio_run(char* jobfile)
+{
+    EXITTYPE result = SUCCEED;
+    int i, running, waiting;
+
+    load_jobs(jobfile);
+    ring_init(job_count);
+
+    do
+    {
+        for (i = 0; i < job_count; i++)
+        {
+            reap();     // I/O finished while the last machine ran
+            if (!jobs[i]->done && !jobs[i]->waiting)
+            {
+                current = jobs[i];
+                load_machine(&current->machine);
+                resumed_at = stats.retired;
+                swapcontext(&scheduler, &current->context);
+                current->retired += stats.retired - resumed_at;
+                current = NULL;
+            }
+        }
+
+        /* count only after the last reap, as a machine seen waiting
+           earlier in the pass may since have been woken */
+        reap();
+        running = waiting = 0;
+        for (i = 0; i < job_count; i++)
+        {
+            if (!jobs[i]->done)
+                running++;
+            if (jobs[i]->waiting)
+                waiting++;
+        }
+
+        /* every live machine is waiting on I/O, so sleep until one
+           of the requests completes */
+        if (running == waiting && 0 < waiting)
+        {
+            enter(1);
+            reap();
+        }
+    } while (0 < running);
+
+    for (i = 0; i < job_count; i++)
+    {
+        printf("Job %d (%s): %s\n", i, jobs[i]->name,
+               SUCCEED == jobs[i]->result ? "succeeded" : "failed");
+        if (FAIL == jobs[i]->result)
+            result = FAIL;
+    }
+    stats_write();
+    exit(result);
+}
+
+
+bool aio_active()
+{
+    return NULL != current;
+}
+
+
+/* aio_retired() - the instructions the running job has retired; the
+   thread's counters are shared by every job, so count its own slices.
+*/
+uint64_t aio_retired()
+{
+    return current->retired + (stats.retired - resumed_at);
+}
+
+
+/* aio_exit() - called from finish() to end the running job and
+   return to the scheduler.
+*/
+void aio_exit(EXITTYPE result)
+{
+    current->done = true;
+    current->result = result;
+    close(current->disk);
+    if (STDIN_FILENO != current->tty_in)
+        close(current->tty_in);
+    if (STDOUT_FILENO != current->tty_out)
+        close(current->tty_out);
+    setcontext(&scheduler);
+}
+
+
+int aio_tty_read()
+{
+    long length;
+
+    if (current->in_pos == current->in_length)
+    {
+        aio_tty_flush();   // show any prompt before waiting for input
+        length = request(IORING_OP_READ, current->tty_in, current->in_buffer,
+                         TTY_BUFFER, -1);
+        if (0 >= length)
+            return EOF;
+        current->in_pos = 0;
+        current->in_length = length;
+    }
+    return (unsigned char) current->in_buffer[current->in_pos++];
+}
+
+
+void aio_tty_write(int ch)
+{
+    current->out_buffer[current->out_length++] = ch;
+    if (TTY_BUFFER == current->out_length)
+        aio_tty_flush();
+}
+
+
+void aio_tty_flush()
+{
+    long written = 0, length;
+
+    while (written < current->out_length)
+    {
+        length = request(IORING_OP_WRITE, current->tty_out,
+                         current->out_buffer + written,
+                         current->out_length - written, -1);
+        if (0 >= length)
+            break;
+        written += length;
+    }
+    current->out_length = 0;
+}
+
+
+long aio_disk_read(char* buffer, long length, off_t offset)
+{
+    return request(IORING_OP_READ, current->disk, buffer, length, offset);
+}
+
+
+long aio_disk_write(char* buffer, long length, off_t offset)
+{
+    return request(IORING_OP_WRITE, current->disk, buffer, length, offset);
+}
+
+
+/* request() - submit one read or write for the running job, suspend it
+   until the completion comes back, and return the result. The request
+   is submitted at once, so that it is in flight while the other jobs
+   run. Without a ring the request is simply carried out synchronously.
+*/
+static long request(int opcode, int fd, void* buffer, long length, off_t offset)
+{
+    struct io_uring_sqe* sqe;
+    unsigned tail, index;
+
+    if (0 > ring_fd)
+    {
+        if (0 > offset)
+            return (IORING_OP_READ == opcode) ? read(fd, buffer, length)
+                                              : write(fd, buffer, length);
+        return (IORING_OP_READ == opcode) ? pread(fd, buffer, length, offset)
+                                          : pwrite(fd, buffer, length, offset);
+    }
+
+    tail = *sq_tail;
+    index = tail & *sq_mask;
+    sqe = &sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->addr = (uintptr_t) buffer;
+    sqe->len = length;
+    sqe->off = (uint64_t) offset;   // -1 uses the file position
+    sqe->user_data = (uintptr_t) current;
+    sq_array[index] = index;
+    __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+    to_submit++;
+    enter(0);
+
+    current->waiting = true;
+    save_machine(&current->machine);
+    swapcontext(&current->context, &scheduler);
+
+    return current->io_result;
+}
+
+
+/* enter() - submit the queued requests and wait for 'wait' completions.
+   A signal, such as the SIGUSR1 for a counter snapshot, only interrupts
+   the wait, so the call is made again.
+*/
+static void enter(unsigned wait)
+{
+    long submitted;
+
+    while (0 > (submitted = syscall(__NR_io_uring_enter, ring_fd, to_submit, wait,
+                                    wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0)))
+    {
+        if (EINTR != errno)
+            finish("io_uring_enter failed", FAIL);
+    }
+    to_submit -= submitted;
+}
+
+
+/* reap() - wake every job whose request has completed. Without a ring
+   the requests are carried out at once, so there is nothing to reap.
+*/
+static void reap()
+{
+    unsigned head, tail;
+    struct io_uring_cqe* cqe;
+    JOB* job;
+
+    if (0 > ring_fd)
+        return;
+
+    head = *cq_head;
+    tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+    while (head != tail)
+    {
+        cqe = &cqes[head & *cq_mask];
+        job = (JOB*) (uintptr_t) cqe->user_data;
+        job->io_result = cqe->res;
+        job->waiting = false;
+        head++;
+    }
+    __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+}
+
+
+/* ring_init() - set up an io_uring with room for a request from every
+   job. If the host refuses, requests fall back to blocking calls.
+*/
+static void ring_init(unsigned entries)
+{
+    struct io_uring_params params;
+    unsigned char *sq_ring, *cq_ring;
+    size_t sq_size, cq_size;
+
+    memset(&params, 0, sizeof(params));
+    ring_fd = syscall(__NR_io_uring_setup, entries, &params);
+    if (0 > ring_fd)
+    {
+        fputs("io_uring unavailable, using blocking I/O\n", stderr);
+        return;
+    }
+
+    sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+        sq_size = cq_size = (sq_size > cq_size) ? sq_size : cq_size;
+
+    sq_ring = mmap(NULL, sq_size, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+    if (MAP_FAILED == sq_ring)
+        finish("Could not map io_uring", FAIL);
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+        cq_ring = sq_ring;
+    else
+    {
+        cq_ring = mmap(NULL, cq_size, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+        if (MAP_FAILED == cq_ring)
+            finish("Could not map io_uring", FAIL);
+    }
+    sqes = mmap(NULL, params.sq_entries * sizeof(struct io_uring_sqe),
+                PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                ring_fd, IORING_OFF_SQES);
+    if (MAP_FAILED == sqes)
+        finish("Could not map io_uring", FAIL);
+
+    sq_tail  = (unsigned*) (sq_ring + params.sq_off.tail);
+    sq_mask  = (unsigned*) (sq_ring + params.sq_off.ring_mask);
+    sq_array = (unsigned*) (sq_ring + params.sq_off.array);
+    cq_head  = (unsigned*) (cq_ring + params.cq_off.head);
+    cq_tail  = (unsigned*) (cq_ring + params.cq_off.tail);
+    cq_mask  = (unsigned*) (cq_ring + params.cq_off.ring_mask);
+    cqes     = (struct io_uring_cqe*) (cq_ring + params.cq_off.cqes);
+}
+
+
+/* load_jobs() - read the job file, and load each machine's program
+   and open its files.
+*/
+static void load_jobs(char* jobfile)
+{
+    FILE* list;
+    char line[1024], prog[256], disk[256], tty_in[256], tty_out[256];
+    int fields;
+    JOB* job;
+
+    if (NULL == (list = fopen(jobfile, "r")))
+        finish("Job file not found", FAIL);
+
+    while (NULL != fgets(line, sizeof(line), list))
+    {
+        fields = sscanf(line, "%255s %255s %255s %255s", prog, disk, tty_in, tty_out);
+        if (0 >= fields || '#' == prog[0])
+            continue;
+        if (2 > fields)
+            finish("Job needs a program and a disk image", FAIL);
+        if (MAX_JOBS == job_count)
+            finish("Too many jobs", FAIL);
+
+        job = calloc(1, sizeof(JOB));
+        if (NULL == job)
+            finish("Out of memory", FAIL);
+        strcpy(job->name, prog);
+
+        if (NULL == (program = fopen(prog, "r")))
+            finish("Program file not found", FAIL);
+        load_program();
+        save_machine(&job->machine);
+        fclose(program);
+        program = NULL;
+
+        if (0 > (job->disk = open(disk, O_RDWR)))
+            finish("Could not create disk image file", FAIL);
+        job->tty_in = (2 < fields) ? open(tty_in, O_RDONLY) : STDIN_FILENO;
+        job->tty_out = (3 < fields) ? open(tty_out, O_WRONLY | O_CREAT | O_TRUNC, 0644)
+                                    : STDOUT_FILENO;
+        if (0 > job->tty_in || 0 > job->tty_out)
+            finish("Could not open job TTY", FAIL);
+
+        job->stack = mmap(NULL, JOB_STACK, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (MAP_FAILED == job->stack)
+            finish("Out of memory", FAIL);
+        getcontext(&job->context);
+        job->context.uc_stack.ss_sp = job->stack;
+        job->context.uc_stack.ss_size = JOB_STACK;
+        job->context.uc_link = &scheduler;
+        makecontext(&job->context, job_main, 0);
+
+        jobs[job_count++] = job;
+    }
+    fclose(list);
+
+    if (0 == job_count)
+        finish("No jobs to run", FAIL);
+}
+
+
+static void job_main()
+{
+    run_machine();
+}
@@ -0,0 +1,42 @@
+/* aio.h
+ * version 00.01.00
+ * Copyright (C) 2011  Joseph Osako
+ * This file is part of Pmac-Passim.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AIO_H
+#define AIO_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include "pmac.h"
+
+/* batch driver */
+void aio_run(char* jobfile);
+bool aio_active(void);
+void aio_exit(EXITTYPE result);
+uint64_t aio_retired(void);
+
+/* asynchronous port I/O for the running job */
+int aio_tty_read(void);
+void aio_tty_write(int ch);
+void aio_tty_flush(void);
+long aio_disk_read(char* buffer, long length, off_t offset);
+long aio_disk_write(char* buffer, long length, off_t offset);
+
+#endif
@@ -0,0 +1,327 @@
+/* cache.c - block cache for the text disk image.
+ * The disk image keeps its one-record-per-word text layout, but the
+ * FDD port no longer seeks and scans a single record per access.
+ * Words are read a block at a time, and when the accesses run through
+ * the image in order, several blocks are read ahead in one go. Written
+ * words are held in the cache and only go to the image when their
+ * block is evicted or when the machine finishes, gathered into runs of
+ * consecutive records so that each run is a single write.
+ * version 00.01.00
+ * Copyright (C) 2011  Joseph Osako
+ * This file is part of Pmac-Passim.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <sys/types.h>
+#include "pmac.h"
+#include "io.h"
+#include "cache.h"
+
+#define BLOCK_WORDS   512       // words per cache block
+#define CACHE_BLOCKS  64        // blocks in the cache, a power of two
+#define MAX_AHEAD     8         // most blocks read in one go
+
+#define DIRTY_WORDS   (BLOCK_WORDS / 64)
+
+typedef struct
+{
+    long number;                // block number in the image, -1 if free
+    bool loaded;                // clean words have been read from the image
+    bool dirty;                 // at least one word is waiting to be written
+    uint64_t dirty_map[DIRTY_WORDS];
+    uint32_t words[BLOCK_WORDS];
+} BLOCK;
+
+struct CACHE
+{
+    BLOCK* blocks;
+    long last_block;            // for spotting sequential access
+    int read_ahead;
+    char* buffer;               // record text for reads and writes
+};
+
+/* the cache of the disk image the machine on this thread is using */
+static _Thread_local CACHE* disk = NULL;
+
+static CACHE* cache_init(void);
+static BLOCK* lookup(long number);
+static void fill(long number);
+static void write_back(BLOCK* block);
+static void write_run(long first, long count);
+static uint32_t parse_record(const char* record);
+
+#define IS_DIRTY(block, i) (((block)->dirty_map[(i) / 64] >> ((i) % 64)) & 1)
+
+
+uint32_t cache_read(uint64_t seek)
+{
+    long number = seek / BLOCK_WORDS;
+    BLOCK* block = lookup(number);
+
+    if (!block->loaded)
+    {
+        /* grow the read-ahead while the program walks the image in order */
+        if (number == disk->last_block + 1)
+            disk->read_ahead = (MAX_AHEAD > disk->read_ahead) ? disk->read_ahead * 2 : MAX_AHEAD;
+        else
+            disk->read_ahead = 1;
+        fill(number);
+    }
+    disk->last_block = number;
+    return block->words[seek % BLOCK_WORDS];
+}
+
+
+void cache_write(uint64_t seek, uint32_t value)
+{
+    long number = seek / BLOCK_WORDS;
+    int i = seek % BLOCK_WORDS;
+    BLOCK* block = lookup(number);
+
+    block->words[i] = value;
+    block->dirty_map[i / 64] |= (uint64_t) 1 << (i % 64);
+    block->dirty = true;
+    disk->last_block = number;
+}
+
+
+/* cache_flush() - write every dirty block back to the image, in
+   image order, so that neighbouring blocks make one sequential write.
+*/
+void cache_flush()
+{
+    long first = -1, count = 0, base;
+    int slot, i;
+    BLOCK* block;
+    bool any;
+
+    if (NULL == disk)
+        return;
+
+    /* the blocks are direct mapped, so walk them in block number order */
+    do
+    {
+        block = NULL;
+        for (slot = 0; slot < CACHE_BLOCKS; slot++)
+        {
+            if (disk->blocks[slot].dirty && (NULL == block || disk->blocks[slot].number < block->number))
+                block = &disk->blocks[slot];
+        }
+        any = (NULL != block);
+        if (!any)
+            break;
+
+        base = block->number * BLOCK_WORDS;
+        for (i = 0; i < BLOCK_WORDS; i++)
+        {
+            if (!IS_DIRTY(block, i))
+                continue;
+            if (0 < count && first + count == base + i)
+            {
+                count++;
+                continue;
+            }
+            write_run(first, count);
+            first = base + i;
+            count = 1;
+        }
+        /* the run may carry on into the next block, so it is only
+           written once a gap turns up; the words stay in their slots */
+        block->dirty = false;
+        memset(block->dirty_map, 0, sizeof(block->dirty_map));
+    } while (any);
+
+    write_run(first, count);
+    fflush(diskimg);
+}
+
+
+/* cache_current() - the cache of this thread's disk image, so that
+   the cores of an SMP run can share it (see smp.c)
+*/
+CACHE* cache_current()
+{
+    if (NULL == disk)
+        disk = cache_init();
+    return disk;
+}
+
+
+void cache_share(CACHE* cache)
+{
+    disk = cache;
+}
+
+
+static CACHE* cache_init()
+{
+    CACHE* cache;
+    int slot;
+
+    cache = malloc(sizeof(CACHE));
+    if (NULL == cache)
+        finish("Out of memory", FAIL);
+    cache->blocks = malloc(CACHE_BLOCKS * sizeof(BLOCK));
+    cache->buffer = malloc(MAX_AHEAD * BLOCK_WORDS * 9 + 1);
+    if (NULL == cache->blocks || NULL == cache->buffer)
+        finish("Out of memory", FAIL);
+    cache->last_block = -1;
+    cache->read_ahead = 1;
+    for (slot = 0; slot < CACHE_BLOCKS; slot++)
+    {
+        cache->blocks[slot].number = -1;
+        cache->blocks[slot].loaded = cache->blocks[slot].dirty = false;
+        memset(cache->blocks[slot].dirty_map, 0, sizeof(cache->blocks[slot].dirty_map));
+    }
+    return cache;
+}
+
+
+/* lookup() - find the cache slot for a block, claiming it if needed.
+   A dirty block that has to make way is written back first.
+*/
+static BLOCK* lookup(long number)
+{
+    BLOCK* block;
+
+    if (NULL == disk)
+        disk = cache_init();
+
+    block = &disk->blocks[number & (CACHE_BLOCKS - 1)];
+    if (block->number != number)
+    {
+        if (block->dirty)
+            write_back(block);
+        block->number = number;
+        block->loaded = false;
+    }
+    return block;
+}
+
+
+/* fill() - read the block, and as many of the blocks after it as the
+   read-ahead allows, with a single read of the image. Words that have
+   been written but not flushed keep their cached values.
+*/
+static void fill(long number)
+{
+    long count, got, words, n;
+    int i;
+    BLOCK* block;
+    char* record;
+
+    /* only read ahead into blocks that are not already there */
+    for (count = 1; count < disk->read_ahead; count++)
+    {
+        block = &disk->blocks[(number + count) & (CACHE_BLOCKS - 1)];
+        if (block->number == number + count && block->loaded)
+            break;
+    }
+
+    /* claim the slots first, as evicting a block reuses the buffer */
+    for (n = 1; n < count; n++)
+        lookup(number + n);
+
+    fseeko(diskimg, (off_t) number * BLOCK_WORDS * DISK_RECORD, SEEK_SET);
+    got = fread(disk->buffer, 1, count * BLOCK_WORDS * DISK_RECORD, diskimg);
+    words = got / DISK_RECORD;
+
+    for (n = 0; n < count; n++)
+    {
+        block = &disk->blocks[(number + n) & (CACHE_BLOCKS - 1)];
+        for (i = 0; i < BLOCK_WORDS; i++)
+        {
+            if (IS_DIRTY(block, i))
+                continue;
+            record = disk->buffer + (n * BLOCK_WORDS + i) * DISK_RECORD;
+            block->words[i] = (n * BLOCK_WORDS + i < words) ? parse_record(record) : 0;
+        }
+        block->loaded = true;
+    }
+}
+
+
+/* write_back() - write out the dirty words of one block */
+static void write_back(BLOCK* block)
+{
+    long first = -1, count = 0, base = block->number * BLOCK_WORDS;
+    int i;
+
+    for (i = 0; i < BLOCK_WORDS; i++)
+    {
+        if (!IS_DIRTY(block, i))
+            continue;
+        if (0 < count && first + count == base + i)
+        {
+            count++;
+            continue;
+        }
+        write_run(first, count);
+        first = base + i;
+        count = 1;
+    }
+    write_run(first, count);
+    block->dirty = false;
+    memset(block->dirty_map, 0, sizeof(block->dirty_map));
+}
+
+
+/* write_run() - format a run of consecutive words as records and write
+   them to the image with one seek and one write.
+*/
+static void write_run(long first, long count)
+{
+    BLOCK* block;
+    long seek, done, length;
+
+    for (done = 0; done < count; done += length / DISK_RECORD)
+    {
+        length = 0;
+        for (seek = first + done;
+             seek < first + count && length < MAX_AHEAD * BLOCK_WORDS * DISK_RECORD;
+             seek++)
+        {
+            block = &disk->blocks[(seek / BLOCK_WORDS) & (CACHE_BLOCKS - 1)];
+            sprintf(disk->buffer + length, DISK_FORMAT, block->words[seek % BLOCK_WORDS]);
+            length += DISK_RECORD;
+        }
+        fseeko(diskimg, (off_t) (first + done) * DISK_RECORD, SEEK_SET);
+        fwrite(disk->buffer, 1, length, diskimg);
+    }
+}
+
+
+/* parse_record() - read the hex word in one record, as fscanf() would;
+   anything that is not a hex digit (such as the zero bytes left where
+   the image was extended by a seek) reads as zero.
+*/
+static uint32_t parse_record(const char* record)
+{
+    uint32_t value = 0;
+    int i = 0;
+
+    while (i < DISK_RECORD - 1 && ' ' == record[i])
+        i++;
+    for (; i < DISK_RECORD - 1 && isxdigit((unsigned char) record[i]); i++)
+        value = (value << 4) | (isdigit((unsigned char) record[i])
+                                ? record[i] - '0'
+                                : (toupper((unsigned char) record[i]) - 'A' + 10));
+    return value;
+}
@@ -0,0 +1,35 @@
+/* cache.h
+ * version 00.01.00
+ * Copyright (C) 2011  Joseph Osako
+ * This file is part of Pmac-Passim.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdint.h>
+
+typedef struct CACHE CACHE;
+
+/* block cache in front of the text disk image */
+uint32_t cache_read(uint64_t seek);
+void cache_write(uint64_t seek, uint32_t value);
+void cache_flush(void);
+CACHE* cache_current(void);
+void cache_share(CACHE* cache);
+
+#endif
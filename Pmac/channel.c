@@ -0,0 +1,367 @@
+/* channel.c - pipelines of pmac machines joined by channels.
+ * 'pmac -p <pipeline>' runs several machines in one process, each on a
+ * host thread of its own, so that the stages of a pipeline run at the
+ * same time. The stages pass words to each other through channels,
+ * which are bounded single-producer, single-consumer rings with no
+ * locks: the writer alone moves the tail and the reader alone moves
+ * the head.
+ *
+ * Each line of the pipeline file names one stage and the channels it
+ * reads ('<n') and writes ('>n'):
+ *     <program> <diskimg> [<n ...] [>n ...]
+ * A channel has at most one reader and one writer. When its writer
+ * halts, the channel is closed and its reader sees the end of the data
+ * once the rest has been read; when its reader halts, whatever is
+ * written to it is thrown away.
+ *
+ * For channel n, IN and OUT on port CHANNEL_PORT + n move a single word;
+ * IN on a closed and empty channel gives all ones, like the TTY's end of
+ * file. Port BLOCK_PORT + n moves 'count' words at 'address' in one go:
+ *     OUT:  count, address, port  ->
+ *     IN:   count, address, port  -> words read
+ * where a block read only comes up short at the end of the data.
+ *
+ * version 00.01.00
+ * Copyright (C) 2011  Joseph Osako
+ * This file is part of Pmac-Passim.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sched.h>
+#include <time.h>
+#include <pthread.h>
+#include "pmac.h"
+#include "io.h"
+#include "channel.h"
+#include "smp.h"
+#include "stats.h"
+
+#define MAX_STAGES  MAX_CORES       // each stage has a set of counters
+#define NO_STAGE    (-1)
+
+typedef struct
+{
+    /* the two ends are kept on separate cache lines */
+    uint32_t tail __attribute__((aligned(64)));    // next slot to write
+    uint32_t head_seen;                             // the writer's last look at head
+    uint32_t head __attribute__((aligned(64)));    // next slot to read
+    uint32_t tail_seen;                             // the reader's last look at tail
+    bool closed __attribute__((aligned(64)));      // the writer has finished
+    bool abandoned;                                 // the reader has finished
+    int writer, reader;
+    uint32_t words[CHANNEL_WORDS];
+} CHANNEL;
+
+typedef struct
+{
+    char name[256];
+    MACHINE machine;
+    FILE* disk;
+    pthread_t thread;
+} STAGE;
+
+static CHANNEL* channels = NULL;
+static STAGE stages[MAX_STAGES];
+static int stage_count = 0;
+static _Thread_local int stage = NO_STAGE;     // the stage on this thread
+
+static void load_stages(char* pipeline);
+static void connect(int number, char* end);
+static void* run_stage(void* number);
+static uint32_t receive(unsigned channel, void* words, uint32_t count, bool wide);
+static void send(unsigned channel, const void* words, uint32_t count, bool wide);
+static CHANNEL* end(unsigned channel, bool writing);
+static void pause_for(int* rounds);
+
+
+/* channel_run() - load every stage of the pipeline, run them together
+   and exit once they have all halted.
+*/
+void channel_run(char* pipeline)
+{
+    int i;
+
+    channels = calloc(CHANNELS, sizeof(CHANNEL));
+    if (NULL == channels)
+        finish("Out of memory", FAIL);
+    for (i = 0; i < CHANNELS; i++)
+        channels[i].writer = channels[i].reader = NO_STAGE;
+
+    load_stages(pipeline);
+
+    /* an end nobody holds is finished before the run begins */
+    for (i = 0; i < CHANNELS; i++)
+    {
+        channels[i].closed = (NO_STAGE == channels[i].writer);
+        channels[i].abandoned = (NO_STAGE == channels[i].reader);
+    }
+
+    for (i = 0; i < stage_count; i++)
+    {
+        if (0 != pthread_create(&stages[i].thread, NULL, run_stage, (void*) (intptr_t) i))
+            finish("Could not start a stage", FAIL);
+    }
+    for (i = 0; i < stage_count; i++)
+        pthread_join(stages[i].thread, NULL);
+
+    for (i = 0; i < stage_count; i++)
+        printf("Stage %d (%s): halted\n", i, stages[i].name);
+    stats_write();
+    exit(SUCCEED);
+}
+
+
+bool channel_active()
+{
+    return NO_STAGE != stage;
+}
+
+
+/* channel_exit() - called by finish() when a stage halts. Its disk is
+   written back and its channels closed, and the thread ends, leaving
+   the other stages running. An error ends the whole run instead.
+*/
+void channel_exit(EXITTYPE result)
+{
+    int i;
+
+    if (FAIL == result)
+        return;
+
+    for (i = 0; i < CHANNELS; i++)
+    {
+        if (stage == channels[i].writer)
+            __atomic_store_n(&channels[i].closed, true, __ATOMIC_RELEASE);
+        if (stage == channels[i].reader)
+            __atomic_store_n(&channels[i].abandoned, true, __ATOMIC_RELEASE);
+    }
+    fdd_flush();
+    fclose(diskimg);
+    diskimg = NULL;
+    pthread_exit(NULL);
+}
+
+
+uint32_t channel_read(unsigned channel)
+{
+    uint32_t value;
+
+    if (0 == receive(channel, &value, 1, true))
+        value = UINT32_MAX;
+    return value;
+}
+
+
+void channel_write(unsigned channel, uint32_t value)
+{
+    send(channel, &value, 1, true);
+}
+
+
+/* channel_receive(), channel_send() - move a block of machine words */
+uint32_t channel_receive(unsigned channel, void* words, uint32_t count)
+{
+    return receive(channel, words, count, WIDE);
+}
+
+
+void channel_send(unsigned channel, const void* words, uint32_t count)
+{
+    send(channel, words, count, WIDE);
+}
+
+
+/* load_stages() - read the pipeline file, load each stage's program
+   and open its disk image.
+*/
+static void load_stages(char* pipeline)
+{
+    FILE* list;
+    char line[1024], prog[256], disk[256];
+    char* field;
+    int offset;
+
+    if (NULL == (list = fopen(pipeline, "r")))
+        finish("Pipeline file not found", FAIL);
+
+    while (NULL != fgets(line, sizeof(line), list))
+    {
+        if (1 > sscanf(line, "%255s", prog) || '#' == prog[0])
+            continue;
+        if (2 != sscanf(line, "%255s %255s%n", prog, disk, &offset))
+            finish("Stage needs a program and a disk image", FAIL);
+        if (MAX_STAGES == stage_count)
+            finish("Too many stages", FAIL);
+
+        for (field = strtok(line + offset, " \t\n"); NULL != field; field = strtok(NULL, " \t\n"))
+            connect(stage_count, field);
+
+        strcpy(stages[stage_count].name, prog);
+        if (NULL == (program = fopen(prog, "r")))
+            finish("Program file not found", FAIL);
+        load_program();
+        save_machine(&stages[stage_count].machine);
+        fclose(program);
+        program = NULL;
+
+        if (NULL == (stages[stage_count].disk = fopen(disk, "rw+")))
+            finish("Could not create disk image file", FAIL);
+        stage_count++;
+    }
+    fclose(list);
+    if (0 == stage_count)
+        finish("Empty pipeline", FAIL);
+}
+
+
+/* connect() - attach a stage to one end of a channel, '<n' or '>n' */
+static void connect(int number, char* end)
+{
+    int channel;
+    int* holder;
+
+    if (('<' != end[0] && '>' != end[0]) || 1 != sscanf(end + 1, "%d", &channel)
+        || 0 > channel || CHANNELS <= channel)
+        finish("Invalid channel in pipeline", FAIL);
+
+    holder = ('>' == end[0]) ? &channels[channel].writer : &channels[channel].reader;
+    if (NO_STAGE != *holder)
+        finish("A channel has one reader and one writer", FAIL);
+    *holder = number;
+}
+
+
+static void* run_stage(void* number)
+{
+    stage = (intptr_t) number;
+    stats_core = &stats_cores[stage];
+    load_machine(&stages[stage].machine);
+    diskimg = stages[stage].disk;
+    run_machine();
+    return NULL;
+}
+
+
+/* receive() - read up to 'count' words, waiting for the writer as
+   needed. Only the end of the data stops it short.
+*/
+static uint32_t receive(unsigned channel, void* words, uint32_t count, bool wide)
+{
+    CHANNEL* c = end(channel, false);
+    uint32_t done = 0, ready, i, head;
+    int rounds = 0;
+
+    while (done < count)
+    {
+        head = c->head;
+        ready = c->tail_seen - head;
+        if (0 == ready)
+        {
+            c->tail_seen = __atomic_load_n(&c->tail, __ATOMIC_ACQUIRE);
+            ready = c->tail_seen - head;
+        }
+        if (0 == ready)
+        {
+            /* the writer may have written its last words and closed
+               the channel since the look at the tail */
+            if (__atomic_load_n(&c->closed, __ATOMIC_ACQUIRE)
+                && c->tail_seen == __atomic_load_n(&c->tail, __ATOMIC_ACQUIRE))
+                break;
+            pause_for(&rounds);
+            continue;
+        }
+        if (ready > count - done)
+            ready = count - done;
+        for (i = 0; i < ready; i++)
+        {
+            if (wide)
+                ((uint32_t*) words)[done + i] = c->words[(head + i) & (CHANNEL_WORDS - 1)];
+            else
+                ((uint16_t*) words)[done + i] = c->words[(head + i) & (CHANNEL_WORDS - 1)];
+        }
+        __atomic_store_n(&c->head, head + ready, __ATOMIC_RELEASE);
+        done += ready;
+        rounds = 0;
+    }
+    stats.bytes_in += done * (WIDE ? 4 : 2);
+    return done;
+}
+
+
+/* send() - write 'count' words, waiting for room as needed */
+static void send(unsigned channel, const void* words, uint32_t count, bool wide)
+{
+    CHANNEL* c = end(channel, true);
+    uint32_t done = 0, room, i, tail;
+    int rounds = 0;
+
+    stats.bytes_out += count * (WIDE ? 4 : 2);
+    while (done < count)
+    {
+        if (__atomic_load_n(&c->abandoned, __ATOMIC_ACQUIRE))
+            return;
+        tail = c->tail;
+        room = CHANNEL_WORDS - (tail - c->head_seen);
+        if (0 == room)
+        {
+            c->head_seen = __atomic_load_n(&c->head, __ATOMIC_ACQUIRE);
+            room = CHANNEL_WORDS - (tail - c->head_seen);
+        }
+        if (0 == room)
+        {
+            pause_for(&rounds);
+            continue;
+        }
+        if (room > count - done)
+            room = count - done;
+        for (i = 0; i < room; i++)
+        {
+            c->words[(tail + i) & (CHANNEL_WORDS - 1)] =
+                wide ? ((const uint32_t*) words)[done + i] : ((const uint16_t*) words)[done + i];
+        }
+        __atomic_store_n(&c->tail, tail + room, __ATOMIC_RELEASE);
+        done += room;
+        rounds = 0;
+    }
+}
+
+
+/* end() - the channel, if this stage holds the end being used */
+static CHANNEL* end(unsigned channel, bool writing)
+{
+    if (!channel_active() || CHANNELS <= channel
+        || stage != (writing ? channels[channel].writer : channels[channel].reader))
+        finish("Channel not connected to this stage", FAIL);
+    return &channels[channel];
+}
+
+
+/* pause_for() - wait for the other end; give up the host core at once,
+   and sleep a little once the wait has gone on for a while
+*/
+static void pause_for(int* rounds)
+{
+    struct timespec nap = {0, 50000};
+
+    if (100 > ++*rounds)
+        sched_yield();
+    else
+        nanosleep(&nap, NULL);
+}
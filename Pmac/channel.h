@@ -0,0 +1,42 @@
+/* channel.h
+ * version 00.01.00
+ * Copyright (C) 2011  Joseph Osako
+ * This file is part of Pmac-Passim.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef CHANNEL_H
+#define CHANNEL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pmac.h"
+
+#define CHANNELS        16          // ports CHANNEL_PORT to CHANNEL_PORT + 15, and the same for blocks
+#define CHANNEL_WORDS   4096        // words a channel holds, a power of two
+
+/* pipeline driver */
+void channel_run(char* pipeline);
+bool channel_active(void);
+void channel_exit(EXITTYPE result);
+
+/* port transfers for the running stage */
+uint32_t channel_read(unsigned channel);
+void channel_write(unsigned channel, uint32_t value);
+uint32_t channel_receive(unsigned channel, void* words, uint32_t count);
+void channel_send(unsigned channel, const void* words, uint32_t count);
+
+#endif
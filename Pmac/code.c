@@ -0,0 +1,149 @@
+/* code.c - code segments shared between machines.
+ * An image may declare a range of words as read-only code with a
+ * '.CODE <first> <last>' line in its header. The first machine to load
+ * the image copies the host pages holding that range into an anonymous
+ * file; every machine loaded from the same image afterwards - the jobs
+ * of a batch or the stages of a pipeline - maps those pages privately
+ * from the file instead of reading them, so they are held once however
+ * many machines run the program. A store into the range only copies the
+ * page it falls in, for the machine that made it.
+ *
+ * The machine interprets its memory as it stands, with no decoded form
+ * of the program, so the words of the range are all there is to share.
+ *
+ * version 00.01.00
+ * Copyright (C) 2011  Joseph Osako
+ * This file is part of Pmac-Passim.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#define _GNU_SOURCE     // for memfd_create()
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "pmac.h"
+#include "code.h"
+
+#define MAX_SEGMENTS 32
+
+/* the pages of one image's code range, kept in an anonymous file */
+typedef struct
+{
+    dev_t device;               // the image file
+    ino_t inode;
+    bool wide;
+    uint32_t first, last;       // the range it declares
+    int fd;
+} SEGMENT;
+
+_Thread_local bool code_declared = false;
+_Thread_local uint32_t code_first = 0, code_last = 0;
+_Thread_local uint64_t code_from = 0, code_to = 0;
+
+/* the machines are all loaded by the main thread, one after another */
+static SEGMENT segments[MAX_SEGMENTS];
+static int segment_count = 0;
+static SEGMENT pending;         // a new segment, made once the image is read
+static bool unshared = false;
+
+static void page_range(uint64_t* from, uint64_t* to);
+static void* words(uint64_t word);
+
+
+/* code_map() - before the image is read, map the code range of an image
+   already seen, and leave read_program() to skip those words
+*/
+void code_map()
+{
+    struct stat image;
+    int i;
+
+    code_from = code_to = 0;
+    unshared = false;
+    if (!code_declared)
+        return;
+    if (code_first > code_last || code_last >= (WIDE ? 0x100000000ULL : 0x10000ULL))
+        finish("Invalid code range", FAIL);
+    if (0 != fstat(fileno(program), &image))
+        finish("Could not read program file", FAIL);
+
+    for (i = 0; i < segment_count; i++)
+    {
+        if (segments[i].device == image.st_dev && segments[i].inode == image.st_ino
+            && segments[i].wide == WIDE && segments[i].first == code_first
+            && segments[i].last == code_last)
+        {
+            page_range(&code_from, &code_to);
+            if (MAP_FAILED == mmap(words(code_from), (code_to - code_from) * (WIDE ? 4 : 2),
+                                   PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED,
+                                   segments[i].fd, 0))
+                finish("Could not map code segment", FAIL);
+            return;
+        }
+    }
+
+    pending.device = image.st_dev;
+    pending.inode = image.st_ino;
+    pending.wide = WIDE;
+    pending.first = code_first;
+    pending.last = code_last;
+    unshared = true;
+}
+
+
+/* code_share() - once an image is read for the first time, move the
+   pages of its code range into a file and map them back from it
+*/
+void code_share()
+{
+    uint64_t from, to;
+    size_t length;
+
+    if (!unshared || MAX_SEGMENTS == segment_count)
+        return;     // nothing new, or no room to keep it: the machine keeps its own copy
+    unshared = false;
+
+    page_range(&from, &to);
+    length = (to - from) * (WIDE ? 4 : 2);
+    if (0 > (pending.fd = memfd_create("pmac-code", MFD_CLOEXEC)))
+        finish("Could not create code segment", FAIL);
+    if ((ssize_t) length != pwrite(pending.fd, words(from), length, 0))
+        finish("Could not create code segment", FAIL);
+    if (MAP_FAILED == mmap(words(from), length, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_FIXED, pending.fd, 0))
+        finish("Could not map code segment", FAIL);
+
+    segments[segment_count++] = pending;
+}
+
+
+/* page_range() - the words of the whole host pages holding the range */
+static void page_range(uint64_t* from, uint64_t* to)
+{
+    uint64_t page = sysconf(_SC_PAGESIZE) / (WIDE ? 4 : 2);
+
+    *from = code_first / page * page;
+    *to = ((uint64_t) code_last / page + 1) * page;
+}
+
+
+/* words() - where the host keeps a word of the machine's memory */
+static void* words(uint64_t word)
+{
+    return (char*) machine_range(0, 0) + word * (WIDE ? 4 : 2);
+}
@@ -0,0 +1,37 @@
+/* code.h
+ * version 00.01.00
+ * Copyright (C) 2011  Joseph Osako
+ * This file is part of Pmac-Passim.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef CODE_H
+#define CODE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* the read-only code range an image declares with '.CODE', if any */
+extern _Thread_local bool code_declared;
+extern _Thread_local uint32_t code_first, code_last;
+
+/* the words read_program() leaves alone, as they are already mapped */
+extern _Thread_local uint64_t code_from, code_to;
+
+void code_map(void);
+void code_share(void);
+
+#endif
@@ -0,0 +1,131 @@
+/* coverage.c - edge coverage for fuzzing pmac programs.
+ * Run under afl-fuzz, pmac finds the fuzzer's shared memory through
+ * __AFL_SHM_ID, counts the edges the program takes in it, and answers
+ * the fuzzer's fork server protocol so that each input runs in a fork
+ * of the loaded machine. '-e <file>' instead keeps the map in <file>,
+ * to see what a single run covered.
+ *
+ * The edges are those of the program's branches: the jumps of BRA, BRI,
+ * BSR and RTS, and both ways out of each conditional branch, since the
+ * way not taken leads to a block of its own.
+ *
+ * version 00.01.00
+ * Copyright (C) 2011  Joseph Osako
+ * This file is part of Pmac-Passim.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/shm.h>
+#include <sys/wait.h>
+#include "pmac.h"
+#include "coverage.h"
+
+#define AFL_SHM_ENV     "__AFL_SHM_ID"
+#define FORKSRV_FD      198     // the fuzzer's commands, and FORKSRV_FD + 1 for the answers
+
+uint8_t* coverage_map = NULL;
+_Thread_local uint32_t coverage_last = 0;
+
+static bool fuzzing = false;
+static bool forked = false;     // a child of the fork server, running one input
+
+
+/* coverage_open() - attach the fuzzer's map, or map <path> if given */
+void coverage_open(char* path)
+{
+    char* id = getenv(AFL_SHM_ENV);
+    void* region;
+    int fd;
+
+    if (NULL != id)
+    {
+        region = shmat(atoi(id), NULL, 0);
+        if ((void*) -1 == region)
+            finish("Could not attach the coverage map", FAIL);
+        coverage_map = region;
+        fuzzing = true;
+    }
+    else if (NULL != path)
+    {
+        if (0 > (fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644)))
+            finish("Could not create coverage file", FAIL);
+        if (0 != ftruncate(fd, COVERAGE_SIZE))
+            finish("Could not create coverage file", FAIL);
+        region = mmap(NULL, COVERAGE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (MAP_FAILED == region)
+            finish("Could not map coverage file", FAIL);
+        coverage_map = region;
+    }
+}
+
+
+/* coverage_forkserver() - under the fuzzer, fork a copy of the loaded
+   machine for each input and report how it ended. Only the children
+   return. Without the fuzzer's pipes this does nothing. The fuzzer
+   writes each input to a new file under the same name, so each child
+   opens the disk image afresh.
+*/
+void coverage_forkserver(char* disk_path)
+{
+    uint32_t word = 0;
+    pid_t child;
+    int status;
+
+    if (!fuzzing || sizeof(word) != write(FORKSRV_FD + 1, &word, sizeof(word)))
+        return;
+
+    fflush(stdout);
+    for (;;)
+    {
+        if (sizeof(word) != read(FORKSRV_FD, &word, sizeof(word)))
+            exit(SUCCEED);
+        if (0 > (child = fork()))
+            exit(FAIL);
+        if (0 == child)
+        {
+            close(FORKSRV_FD);
+            close(FORKSRV_FD + 1);
+            forked = true;
+            if (NULL == (diskimg = fopen(disk_path, "r+")))
+                abort();
+            return;
+        }
+        if (sizeof(child) != write(FORKSRV_FD + 1, &child, sizeof(child))
+            || 0 > waitpid(child, &status, 0)
+            || sizeof(status) != write(FORKSRV_FD + 1, &status, sizeof(status)))
+            exit(FAIL);
+    }
+}
+
+
+/* coverage_crash() - called from finish() when the machine faults. The
+   fuzzer only counts a run as a crash if it ends with a signal.
+*/
+void coverage_crash()
+{
+    if (forked)
+    {
+        fflush(stdout);
+        abort();
+    }
+}
@@ -0,0 +1,48 @@
+/* coverage.h
+ * version 00.01.00
+ * Copyright (C) 2011  Joseph Osako
+ * This file is part of Pmac-Passim.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef COVERAGE_H
+#define COVERAGE_H
+
+#include <stdint.h>
+
+/* An AFL-style edge map: a byte counter for each pair of branch targets
+   in a row, found by hashing the two together. */
+
+#define COVERAGE_BITS  16
+#define COVERAGE_SIZE  (1 << COVERAGE_BITS)
+
+extern uint8_t* coverage_map;
+extern _Thread_local uint32_t coverage_last;
+
+void coverage_open(char* path);
+void coverage_forkserver(char* disk_path);
+void coverage_crash(void);
+
+/* coverage_edge() - count the edge into 'target'; called at each branch */
+static inline void coverage_edge(uint32_t target)
+{
+    uint32_t location = (target * 2654435761u) >> (32 - COVERAGE_BITS);
+
+    coverage_map[location ^ coverage_last]++;
+    coverage_last = location >> 1;
+}
+
+#endif
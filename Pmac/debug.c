@@ -0,0 +1,245 @@
+/* debug.c - breakpoints and watchpoints for pmac.
+ * '-k <address>' sets a breakpoint by writing the reserved opcode BRK
+ * over the instruction at <address>, keeping the word it covers in a
+ * table here. Only the BRK case of the interpreter ever looks at the
+ * table, so a run with no breakpoints runs the interpreter loop as it
+ * always does. When a breakpoint is reached the registers are shown and
+ * the machine waits for Enter, as in tracing mode, then runs the
+ * instruction underneath, counted and traced as if the breakpoint were
+ * not there.
+ *
+ * '-w <address>' sets a watchpoint by making the host page holding the
+ * word read-only. A store to the page faults; the handler opens the
+ * page, lets the one host instruction doing the store run with the trap
+ * flag set, and closes the page again when it traps. Stores to the
+ * watched word itself are reported with the old and new value. Single
+ * stepping the host needs the trap flag, so watchpoints are only offered
+ * on x86-64 Linux.
+ *
+ * version 00.01.00
+ * Copyright (C) 2011  Joseph Osako
+ * This file is part of Pmac-Passim.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#define _GNU_SOURCE     // for the registers in ucontext_t
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <signal.h>
+#include <unistd.h>
+#include <ucontext.h>
+#include <sys/mman.h>
+#include "pmac.h"
+#include "debug.h"
+#include "stats.h"
+#include "tracefile.h"
+
+#if defined(__x86_64__) && defined(__linux__)
+#define CAN_WATCH
+#define TRAP_FLAG 0x100
+#endif
+
+typedef struct
+{
+    uint32_t address;
+    uint32_t original;          // the word the BRK covers
+} BREAKPOINT;
+
+typedef struct
+{
+    uint32_t address;
+    char* word;                 // where the host keeps it
+    char* page;
+    uint32_t old;               // its value before the store
+    bool hit;                   // the store in progress writes it
+} WATCHPOINT;
+
+static BREAKPOINT breaks[MAX_BREAKS];
+static WATCHPOINT watches[MAX_WATCHES];
+static int break_count = 0, watch_count = 0;
+static size_t page_size;
+static char* open_page = NULL;  // the page opened for a store in progress
+#ifdef CAN_WATCH
+static struct sigaction chained;    // the handler for faults not ours, such as the stack guard's
+#endif
+
+#ifdef CAN_WATCH
+static void on_fault(int number, siginfo_t* info, void* context);
+static void on_step(int number, siginfo_t* info, void* context);
+#endif
+
+
+/* debug_break_at(), debug_watch() - note the points given as options */
+void debug_break_at(uint32_t address)
+{
+    if (MAX_BREAKS == break_count)
+        finish("Too many breakpoints", FAIL);
+    breaks[break_count++].address = address;
+}
+
+void debug_watch(uint32_t address)
+{
+#ifndef CAN_WATCH
+    finish("Watchpoints are not supported on this host", FAIL);
+#endif
+    if (MAX_WATCHES == watch_count)
+        finish("Too many watchpoints", FAIL);
+    watches[watch_count++].address = address;
+}
+
+
+bool debug_active()
+{
+    return 0 < break_count || 0 < watch_count;
+}
+
+
+/* debug_arm() - plant the breakpoints in the loaded program and close
+   the pages of the watched words
+*/
+void debug_arm()
+{
+#ifdef CAN_WATCH
+    struct sigaction action;
+#endif
+    void* word;
+    int i;
+
+    /* planted through the host pointer, so that the memory heat map
+       does not count the breakpoints as the program's own accesses */
+    for (i = 0; i < break_count; i++)
+    {
+        word = machine_range(breaks[i].address, 1);
+        breaks[i].original = WIDE ? *(uint32_t*) word : *(uint16_t*) word;
+        if (BRK == breaks[i].original)
+            finish("Breakpoint set twice", FAIL);
+        if (WIDE)
+            *(uint32_t*) word = BRK;
+        else
+            *(uint16_t*) word = BRK;
+    }
+
+    if (0 == watch_count)
+        return;
+#ifdef CAN_WATCH
+    page_size = sysconf(_SC_PAGESIZE);
+    memset(&action, 0, sizeof(action));
+    action.sa_flags = SA_SIGINFO;
+    sigemptyset(&action.sa_mask);
+    action.sa_sigaction = on_fault;
+    sigaction(SIGSEGV, &action, &chained);
+    action.sa_sigaction = on_step;
+    sigaction(SIGTRAP, &action, NULL);
+
+    for (i = 0; i < watch_count; i++)
+    {
+        watches[i].word = machine_range(watches[i].address, 1);
+        watches[i].page = (char*) ((uintptr_t) watches[i].word & ~(uintptr_t) (page_size - 1));
+        if (0 != mprotect(watches[i].page, page_size, PROT_READ))
+            finish("Could not set watchpoint", FAIL);
+    }
+#endif
+}
+
+
+/* debug_break() - report a breakpoint and give back the instruction it
+   covers, for the interpreter to run. The counters and the trace record
+   made for the BRK are moved over to that instruction.
+*/
+uint32_t debug_break(uint32_t address)
+{
+    int i;
+
+    for (i = 0; i < break_count && breaks[i].address != address; i++)
+        ;
+    if (break_count == i)
+        finish("BRK without a breakpoint", FAIL);
+
+    stats.classes[(BRK >> 8) & (OPCODE_CLASSES - 1)]--;
+    stats.classes[(breaks[i].original >> 8) & (OPCODE_CLASSES - 1)]++;
+    if (NULL != trace_ring)
+        trace_amend(breaks[i].original);
+
+    printf(WIDE ? "\nBreakpoint at %8x\n" : "\nBreakpoint at %4x\n", address);
+    dumpregs();
+    getchar();
+    return breaks[i].original;
+}
+
+
+#ifdef CAN_WATCH
+/* on_fault() - open the page for the store and step over it. A fault
+   here can only come from a store to the machine's memory, never from
+   within stdio, so the handlers may report with printf.
+*/
+static void on_fault(int number, siginfo_t* info, void* context)
+{
+    char* address = info->si_addr;
+    char* page = (char*) ((uintptr_t) address & ~(uintptr_t) (page_size - 1));
+    size_t word = WIDE ? sizeof(uint32_t) : sizeof(uint16_t);
+    bool watched = false;
+    int i;
+
+    for (i = 0; i < watch_count; i++)
+    {
+        if (watches[i].page != page)
+            continue;
+        watched = true;
+        watches[i].hit = (watches[i].word <= address && address < watches[i].word + word);
+        watches[i].old = WIDE ? *(uint32_t*) watches[i].word : *(uint16_t*) watches[i].word;
+    }
+    if (!watched)
+    {
+        if (chained.sa_flags & SA_SIGINFO)
+            chained.sa_sigaction(number, info, context);
+        else
+            signal(number, SIG_DFL);    // a real fault, to take its course
+        return;
+    }
+
+    mprotect(page, page_size, PROT_READ | PROT_WRITE);
+    open_page = page;
+    ((ucontext_t*) context)->uc_mcontext.gregs[REG_EFL] |= TRAP_FLAG;
+}
+
+
+/* on_step() - the store is done; close the page and report it */
+static void on_step(int number, siginfo_t* info, void* context)
+{
+    uint32_t value;
+    int i;
+
+    (void) number;
+    (void) info;
+    ((ucontext_t*) context)->uc_mcontext.gregs[REG_EFL] &= ~TRAP_FLAG;
+    if (NULL == open_page)
+        return;
+    mprotect(open_page, page_size, PROT_READ);
+
+    for (i = 0; i < watch_count; i++)
+    {
+        if (watches[i].page != open_page || !watches[i].hit)
+            continue;
+        watches[i].hit = false;
+        value = WIDE ? *(uint32_t*) watches[i].word : *(uint16_t*) watches[i].word;
+        printf(WIDE ? "\nWatchpoint at %8x: %8x -> %8x\n" : "\nWatchpoint at %4x: %4x -> %4x\n",
+               watches[i].address, watches[i].old, value);
+        dumpregs();
+    }
+    open_page = NULL;
+}
+#endif
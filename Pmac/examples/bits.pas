@@ -0,0 +1,33 @@
+; bits.pas - ROL, ROR, POPCNT, CLZ, CTZ and BSWAP on the standard machine.
+; Each result is checked in turn; the program halts with 600D on top if all
+; of them are right, or BAD if one is not.
+        PUSH 8001
+        PUSH 1
+        ROL
+        BNE 3 FAIL
+        PUSH 8001
+        PUSH 4
+        ROR
+        BNE 1800 FAIL
+        PUSH F0F0
+        POPCNT
+        BNE 8 FAIL
+        PUSH 0010
+        CLZ
+        BNE B FAIL
+        PUSH 0
+        CLZ
+        BNE 10 FAIL
+        PUSH 0100
+        CTZ
+        BNE 8 FAIL
+        PUSH 0
+        CTZ
+        BNE 10 FAIL
+        PUSH 1234
+        BSWAP
+        BNE 3412 FAIL
+        PUSH 600D
+        HALT
+FAIL:   PUSH BAD
+        HALT
@@ -0,0 +1,29 @@
+; bitsw.pas - assemble with -w: CLZ, CTZ, POPCNT, BSWAP and ROL on
+; 32-bit words, including CLZ and CTZ of 0. Halts with 600D on top if
+; every result is right, or BAD if one is not.
+        PUSH 1
+        CLZ
+        BNE 1F FAIL
+        PUSH 0
+        CLZ
+        BNE 20 FAIL
+        PUSH 80000000
+        CTZ
+        BNE 1F FAIL
+        PUSH 0
+        CTZ
+        BNE 20 FAIL
+        PUSH FFFF0000
+        POPCNT
+        BNE 10 FAIL
+        PUSH 12345678
+        BSWAP
+        BNE 78563412 FAIL
+        PUSH 80000001
+        PUSH 1
+        ROL
+        BNE 3 FAIL
+        PUSH 600D
+        HALT
+FAIL:   PUSH BAD
+        HALT
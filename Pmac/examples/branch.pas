@@ -0,0 +1,32 @@
+; branch.pas - the compare-and-branch opcodes BLT, BEQ, BGE and BLTA, and
+; DBNZ counting down a word of memory. Halts with 600D on top if every
+; branch went the right way, or BAD if one did not.
+        PUSH 0
+        POPA N
+LOOP:   PUSHA N
+        INC
+        DUP
+        POPA N
+        BLT 10 LOOP
+        PUSHA N
+        BNE 10 FAIL
+        PUSH 5
+        BEQ 5 ONE
+        BRA FAIL
+ONE:    PUSH 5
+        BGE 5 TWO
+        BRA FAIL
+TWO:    PUSH 4
+        BLTA N THREE
+        BRA FAIL
+THREE:  PUSH 3
+        POPA N
+        PUSH 0
+FOUR:   INC
+        DBNZ N FOUR
+        BNE 3 FAIL
+        PUSH 600D
+        HALT
+FAIL:   PUSH BAD
+        HALT
+N:      #0
@@ -0,0 +1,71 @@
+#!/bin/sh
+# check.sh - run the example programs and compare what pmac prints, and
+# the files it writes, with the expected copies kept beside them.
+# Usage: check.sh [pmac]    (default: the pmac beside this directory)
+#
+# The images are kept assembled, so that the check needs only pmac; each
+# one was built from the .pas source of the same name.
+
+PMAC=${1:-$(dirname "$0")/../pmac}
+case "$PMAC" in
+    /*) ;;
+    *) PMAC="$PWD/$PMAC" ;;
+esac
+cd "$(dirname "$0")" || exit 1
+
+tmp=$(mktemp -d) || exit 1
+trap 'rm -rf "$tmp"' EXIT
+disk="$tmp/disk.dsk"
+failed=0
+
+# check <name> <pmac arguments>... - run pmac on a fresh copy of the
+# disk image, and compare its output, less blank lines, with <name>.expected
+check()
+{
+    name=$1
+    shift
+    cp disk.dsk "$disk"
+    "$PMAC" "$@" | grep -a -v '^$' > "$tmp/$name.out"
+    same "$name" "$tmp/$name.out" "$name.expected"
+}
+
+# same <name> <file> <expected> - compare a file pmac wrote
+same()
+{
+    if cmp -s "$2" "$3"; then
+        echo "ok   $1"
+    else
+        echo "FAIL $1"
+        diff "$3" "$2"
+        failed=1
+    fi
+}
+
+check wide wide.img "$disk" < /dev/null
+check disk disk.img "$disk" < /dev/null
+same disk.dsk "$disk" disk.dsk.expected
+check dword dword.img "$disk" < /dev/null
+check fddx fddx.img "$disk" < /dev/null
+same fddx.dsk "$disk" fddx.dsk.expected
+check heap heap.img "$disk" < /dev/null
+check frame frame.img "$disk" -s "$tmp/frame.json" < /dev/null
+same frame.json "$tmp/frame.json" frame.json.expected
+check branch branch.img "$disk" < /dev/null
+
+# breakpoints must leave the counters and the heat map as a run without them
+yes '' | check breakpoint branch.img "$disk" -k 22 -k 2e -s "$tmp/breakpoint.json" -m "$tmp/breakpoint.heat"
+same breakpoint.json "$tmp/breakpoint.json" branch.json.expected
+same breakpoint.heat "$tmp/breakpoint.heat" branch.heat.expected
+check retired retired.img "$disk" < /dev/null
+check batch -a retired.jobs < /dev/null
+check fixed fixed.img "$disk" < /dev/null
+check fixedw fixedw.img "$disk" < /dev/null
+check bits bits.img "$disk" < /dev/null
+check bitsw bitsw.img "$disk" < /dev/null
+check guard guard.img "$disk" -l 100 < /dev/null
+yes '' | check guardtrace guard.img "$disk" -t -l 100
+check underflow underflow.img "$disk" -l 100 < /dev/null
+check shard -n 3 shard.img "$disk" -r add < /dev/null
+same shard.dsk "$disk" shard.dsk.expected
+
+exit $failed
@@ -0,0 +1,20 @@
+; disk.pas - reads and writes records of disk.dsk through port 1. Record
+; n is found at the same place for reads as for writes. Halts with 600D
+; on top if every word read back is right, or BAD; the image it leaves
+; is checked against disk.dsk.expected.
+        PUSH 4
+        PUSH 1
+        IN
+        BNE 5 FAIL
+        PUSH BEEF
+        PUSH 3
+        PUSH 1
+        OUT
+        PUSH 3
+        PUSH 1
+        IN
+        BNE BEEF FAIL
+        PUSH 600D
+        HALT
+FAIL:   PUSH BAD
+        HALT
@@ -0,0 +1,46 @@
+; dword.pas - DADD, DMUL, DSUB, DSHL, DSHR and DCMP, with the carries and
+; borrows that cross from the low word to the high one. Halts with 600D
+; on top if every result is right, or BAD if one is not.
+        PUSH FFFF
+        PUSH 1
+        PUSH 1
+        PUSH 0
+        DADD
+        BNE 2 FAIL
+        BNE 0 FAIL
+        PUSH 0
+        PUSH 1
+        PUSH 3
+        PUSH 0
+        DMUL
+        BNE 3 FAIL
+        BNE 0 FAIL
+        PUSH 0
+        PUSH 1
+        PUSH 1
+        PUSH 0
+        DSUB
+        BNE 0 FAIL
+        BNE FFFF FAIL
+        PUSH 1
+        PUSH 0
+        PUSH 11
+        DSHL
+        BNE 2 FAIL
+        BNE 0 FAIL
+        PUSH 0
+        PUSH 1
+        PUSH 4
+        DSHR
+        BNE 0 FAIL
+        BNE 1000 FAIL
+        PUSH 0
+        PUSH 1
+        PUSH FFFF
+        PUSH 0
+        DCMP
+        BNE 1 FAIL
+        PUSH 600D
+        HALT
+FAIL:   PUSH BAD
+        HALT
@@ -0,0 +1,24 @@
+; fddx.pas - reads and writes records of disk.dsk through port 2, which
+; takes its seek as a double word, low word first, including a record
+; past the end of the image. Halts with 600D on top if every word read
+; back is right, or BAD; the image it leaves is checked against
+; fddx.dsk.expected.
+        PUSH 6
+        PUSH 0
+        PUSH 2
+        IN
+        BNE 7 FAIL
+        PUSH 1234
+        PUSH A
+        PUSH 0
+        PUSH 2
+        OUT
+        PUSH A
+        PUSH 0
+        PUSH 2
+        IN
+        BNE 1234 FAIL
+        PUSH 600D
+        HALT
+FAIL:   PUSH BAD
+        HALT
@@ -0,0 +1,34 @@
+; fixed.pas - Q8.8 arithmetic: QMUL rounding to nearest with halves upwards,
+; for negative products too, QDIV, QSQRT, and QADD and QSUB saturating.
+; Halts with 600D on top if every result is right, or BAD if one is not.
+        PUSH 180
+        PUSH 280
+        QMUL
+        BNE 3C0 FAIL
+        PUSH FF80
+        PUSH 180
+        QMUL
+        BNE FF40 FAIL
+        PUSH FFFF
+        PUSH 80
+        QMUL
+        BNE 0 FAIL
+        PUSH 100
+        PUSH 300
+        QDIV
+        BNE 55 FAIL
+        PUSH 200
+        QSQRT
+        BNE 16A FAIL
+        PUSH 7000
+        PUSH 7000
+        QADD
+        BNE 7FFF FAIL
+        PUSH 8100
+        PUSH 100
+        QSUB
+        BNE 8000 FAIL
+        PUSH 600D
+        HALT
+FAIL:   PUSH BAD
+        HALT
@@ -0,0 +1,26 @@
+; fixedw.pas - assemble with -w: Q16.16 arithmetic on the 32-bit machine,
+; QMUL rounding to nearest with halves upwards for a negative product,
+; QDIV and QSQRT. Halts with 600D on top if every result is right, or BAD.
+        PUSH 18000
+        PUSH 28000
+        QMUL
+        BNE 3C000 FAIL
+        PUSH FFFFFFFF
+        PUSH 8000
+        QMUL
+        BNE 0 FAIL
+        PUSH FFFF8000
+        PUSH 18000
+        QMUL
+        BNE FFFF4000 FAIL
+        PUSH 10000
+        PUSH 30000
+        QDIV
+        BNE 5555 FAIL
+        PUSH 20000
+        QSQRT
+        BNE 16A09 FAIL
+        PUSH 600D
+        HALT
+FAIL:   PUSH BAD
+        HALT
@@ -0,0 +1,20 @@
+; frame.pas - frames reserved with ENTER and dropped with LEAVE. The
+; first holds 20 locals and is left untouched, but the locals still count
+; towards stack_high_water, which is checked against frame.json.expected;
+; the second writes and reads a local with STOREL and LOADL at a negative
+; offset. Halts with 600D on top if the local read back is right, or BAD.
+        ENTER 20
+        LEAVE
+        ENTER 2
+        PUSH 42
+        STOREL FFFE
+        LOADL FFFE
+        POPA R
+        LEAVE
+        PUSHA R
+        BNE 42 FAIL
+        PUSH 600D
+        HALT
+FAIL:   PUSH BAD
+        HALT
+R:      #0
@@ -0,0 +1,7 @@
+; guard.pas - a short run for -l, whose stack starts below the top guard
+; page. Halts with 600D on top, also when a trace listing with -t comes
+; before the run.
+        PUSH 1
+        DROP
+        PUSH 600D
+        HALT
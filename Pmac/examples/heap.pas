@@ -0,0 +1,33 @@
+; heap.pas - a heap that ends at the very top of the 16-bit memory. The
+; three blocks fill it exactly, so its top is the end of memory; a fourth
+; ALLOC must fail, and FREE and RESIZE must still know the blocks. The
+; stack shares the last block, which the program never stores into.
+; Halts with 600D on top if all is well, or BAD if not.
+        PUSH F3DD
+        PUSH C23
+        HEAP
+        PUSH 3FF
+        ALLOC
+        BNE F401 FAIL
+        PUSH 3FF
+        ALLOC
+        BNE F801 FAIL
+        PUSH 3FF
+        ALLOC
+        BNE FC01 FAIL
+        PUSH 3FF
+        ALLOC
+        BNE 0 FAIL
+        PUSH FC01
+        FREE
+        PUSH 3FF
+        ALLOC
+        BNE FC01 FAIL
+        PUSH F401
+        PUSH 1FF
+        RESIZE
+        BNE F401 FAIL
+        PUSH 600D
+        HALT
+FAIL:   PUSH BAD
+        HALT
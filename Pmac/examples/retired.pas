@@ -0,0 +1,20 @@
+; retired.pas - reads the instructions retired so far from port 3 after a
+; loop which reads the disk on every pass. Halts with 600D on top if the
+; count is exactly A4, or BAD; run twice as a batch with retired.jobs, each
+; job must still see only its own instructions.
+        PUSH 20
+        POPA N
+LOOP:   PUSH 0
+        PUSH 1
+        IN
+        DROP
+        DBNZ N LOOP
+        PUSH 3
+        IN
+        BNE 0 FAIL
+        BNE A4 FAIL
+        PUSH 600D
+        HALT
+FAIL:   PUSH BAD
+        HALT
+N:      #0
@@ -0,0 +1,28 @@
+; shard.pas - run with -n, each shard adds up the records of its range
+; of disk.dsk until the first 0 past its end, doubling each record in
+; place and printing a * for it, and leaves the sum on top. '-r add'
+; totals the shards' sums; the image they leave is checked against
+; shard.dsk.expected.
+        PUSH 0
+LOOP:   PUSHA I
+        PUSH 1
+        IN
+        DUP
+        BRZ DONE
+        DUP
+        DUP
+        ADD
+        PUSHA I
+        PUSH 1
+        OUT
+        ADD
+        PUSH 2A
+        PUSH 0
+        OUT
+        PUSHA I
+        INC
+        POPA I
+        BRA LOOP
+DONE:   DROP
+        HALT
+I:      #0
@@ -0,0 +1,5 @@
+; underflow.pas - pops an empty stack. Run with -l, the first DROP reads
+; the top guard page and stops the machine with a stack underflow.
+        DROP
+        PUSH 600D
+        HALT
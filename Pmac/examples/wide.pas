@@ -0,0 +1,20 @@
+; wide.pas - assemble with -w for the 32-bit machine. Checks that words
+; hold 32 bits, that MUL wraps at 32 bits, and that memory far beyond
+; the first 64K words can be stored and loaded. Halts with 600D on top
+; if every result is right, or BAD if one is not.
+        PUSH 12345678
+        PUSH 10
+        MUL
+        BNE 23456780 FAIL
+        PUSH 10000
+        PUSH 10000
+        MUL
+        BNE 0 FAIL
+        PUSH 89ABCDEF
+        POPA 123456
+        PUSHA 123456
+        BNE 89ABCDEF FAIL
+        PUSH 600D
+        HALT
+FAIL:   PUSH BAD
+        HALT
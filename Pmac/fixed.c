@@ -0,0 +1,139 @@
+/* fixed.c - fixed point opcodes for pmac.
+ * A fixed point word is a signed two's complement number with half of
+ * its bits after the point: Q8.8 on the standard machine and Q16.16 on
+ * the wide one, F = 8 or 16 fraction bits. Every result is exact integer
+ * arithmetic on the words as given below, so any engine that follows it
+ * gets the same bits.
+ *
+ *   QMUL   a b -> floor((a * b + 2^(F-1)) / 2^F): rounded to nearest,
+ *                 halves upwards (towards plus infinity)
+ *   QDIV   a b -> (a * 2^F) / b, truncated towards zero; b = 0 is a
+ *                 divide by zero error
+ *   QSQRT  a   -> floor(sqrt(a * 2^F)); a < 0 is an error
+ *   QADD   a b -> a + b
+ *   QSUB   a b -> a - b
+ *
+ * a is the deeper of the two words. Products, quotients and sums are
+ * worked out in 64 bits and saturated to the range of a signed word,
+ * so an overflow gives the largest or smallest value instead of
+ * wrapping round.
+ *
+ * version 00.01.00
+ * Copyright (C) 2011  Joseph Osako
+ * This file is part of Pmac-Passim.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "pmac.h"
+#include "fixed.h"
+
+#define FRACTION    (WIDE ? 16 : 8)
+#define WORD_MAX    (WIDE ? INT32_MAX : INT16_MAX)
+#define WORD_MIN    (WIDE ? INT32_MIN : INT16_MIN)
+
+static int64_t value(uint32_t word);
+static int64_t floor_shift(int64_t n);
+static uint32_t saturate(int64_t n);
+static uint64_t root(uint64_t n);
+
+
+uint32_t fixed_mul(uint32_t a, uint32_t b)
+{
+    return saturate(floor_shift(value(a) * value(b) + (1 << (FRACTION - 1))));
+}
+
+
+uint32_t fixed_div(uint32_t a, uint32_t b)
+{
+    if (0 == value(b))
+        finish("Divide by Zero Error", FAIL);
+    return saturate(value(a) * (1 << FRACTION) / value(b));
+}
+
+
+uint32_t fixed_sqrt(uint32_t a)
+{
+    if (0 > value(a))
+        finish("Square root of a negative number", FAIL);
+    return saturate(root((uint64_t) value(a) << FRACTION));
+}
+
+
+uint32_t fixed_add(uint32_t a, uint32_t b)
+{
+    return saturate(value(a) + value(b));
+}
+
+
+uint32_t fixed_sub(uint32_t a, uint32_t b)
+{
+    return saturate(value(a) - value(b));
+}
+
+
+/* value() - the word as a signed number */
+static int64_t value(uint32_t word)
+{
+    return WIDE ? (int32_t) word : (int16_t) word;
+}
+
+
+/* floor_shift() - floor(n / 2^F). C leaves >> of a negative number to the
+   compiler, so a negative n is divided as its magnitude, rounding up.
+   The products of two words are well inside the range of int64_t.
+*/
+static int64_t floor_shift(int64_t n)
+{
+    uint64_t magnitude;
+
+    if (0 <= n)
+        return (int64_t) ((uint64_t) n >> FRACTION);
+    magnitude = (uint64_t) -n;
+    return -(int64_t) ((magnitude + (1ULL << FRACTION) - 1) >> FRACTION);
+}
+
+
+/* saturate() - the nearest signed word to n */
+static uint32_t saturate(int64_t n)
+{
+    if (n > WORD_MAX)
+        n = WORD_MAX;
+    else if (n < WORD_MIN)
+        n = WORD_MIN;
+    return WIDE ? (uint32_t) n : (uint16_t) n;
+}
+
+
+/* root() - floor of the square root, a bit at a time */
+static uint64_t root(uint64_t n)
+{
+    uint64_t result = 0, bit = 1ULL << 62;
+
+    while (bit > n)
+        bit >>= 2;
+    while (0 != bit)
+    {
+        if (n >= result + bit)
+        {
+            n -= result + bit;
+            result = (result >> 1) + bit;
+        }
+        else
+            result >>= 1;
+        bit >>= 2;
+    }
+    return result;
+}
@@ -0,0 +1,34 @@
+/* fixed.h
+ * version 00.01.00
+ * Copyright (C) 2011  Joseph Osako
+ * This file is part of Pmac-Passim.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef FIXED_H
+#define FIXED_H
+
+#include <stdint.h>
+
+/* fixed point arithmetic on signed words with half their bits after the
+   point - Q8.8 on the standard machine, Q16.16 on the wide one */
+uint32_t fixed_mul(uint32_t a, uint32_t b);
+uint32_t fixed_div(uint32_t a, uint32_t b);
+uint32_t fixed_sqrt(uint32_t a);
+uint32_t fixed_add(uint32_t a, uint32_t b);
+uint32_t fixed_sub(uint32_t a, uint32_t b);
+
+#endif
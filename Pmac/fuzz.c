@@ -0,0 +1,218 @@
+/* fuzz.c - an in-process fuzzing harness for pmac programs.
+ * Built with libFuzzer, the harness loads the program named by the
+ * PMAC_PROGRAM environment variable once and then runs it on each input
+ * in the same process:
+ *
+ *   clang -O2 -g -fsanitize=fuzzer -DPMAC_FUZZ -pthread -D_FILE_OFFSET_BITS=64 -o pmac-fuzz fuzz.c
+ *       <the sources of pmac, as the README lists them>
+ *   PMAC_PROGRAM=prog.img ./pmac-fuzz corpus/
+ *
+ * The input is both the TTY input and the disk image: TTY reads take its
+ * bytes in turn, and disk word n is made of bytes n * 2 on (n * 4 on for
+ * a wide machine), low byte first. Output to the TTY is dropped, and disk
+ * writes last until the end of the run. The channel ports are not
+ * connected.
+ *
+ * Between runs only the pages of memory the last run wrote are put back
+ * as the program loaded them. With PMAC_FUZZ defined, every store of the
+ * interpreter marks its page in a bitmap, and the pages are also kept in
+ * a list, so a reset costs as much as the run touched rather than the
+ * whole of memory. The branches of the program are counted in libFuzzer's
+ * extra counters (see coverage.c), as well as those of the interpreter.
+ *
+ * version 00.01.00
+ * Copyright (C) 2011  Joseph Osako
+ * This file is part of Pmac-Passim.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include <sys/mman.h>
+#include "pmac.h"
+#include "stats.h"
+#include "coverage.h"
+#include "intrinsic.h"
+#include "fuzz.h"
+
+#ifndef PMAC_FUZZ
+#error "fuzz.c must be built with PMAC_FUZZ defined"
+#endif
+
+#define PAGE_WORDS   (1U << FUZZ_PAGE_SHIFT)
+#define MAX_PAGES    (1U << (32 - FUZZ_PAGE_SHIFT))     // enough for a wide machine
+#define DISK_WORDS   0x10000                            // the disk the harness keeps
+
+uint64_t* fuzz_dirty_map = NULL;
+uint32_t* fuzz_dirty_list = NULL;
+uint32_t fuzz_dirty_count = 0;
+
+/* the program's branches, where libFuzzer looks for extra counters */
+static uint8_t counters[COVERAGE_SIZE] __attribute__((section("__libfuzzer_extra_counters")));
+
+static MACHINE boot;            // the registers as loaded
+static char* snapshot;          // and the pages the load wrote
+static size_t word_size;
+static jmp_buf run_end;
+static bool running = false;
+
+static const uint8_t* input;
+static size_t input_size, input_next;
+static uint32_t disk[DISK_WORDS];
+static size_t disk_used;        // words of the disk that may not be zero
+
+int LLVMFuzzerInitialize(int* argc, char*** argv);
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+static void* reserve(size_t size);
+static void reset(void);
+
+
+/* LLVMFuzzerInitialize() - load the program and keep a copy of the
+   pages it wrote, to reset the machine from
+*/
+int LLVMFuzzerInitialize(int* argc, char*** argv)
+{
+    char* path = getenv("PMAC_PROGRAM");
+    char* core;
+    uint32_t i;
+
+    (void) argc;
+    (void) argv;
+
+    if (NULL == path || NULL == (program = fopen(path, "r")))
+        fuzz_exit("Set PMAC_PROGRAM to the program image to fuzz", FAIL);
+
+    fuzz_dirty_map = reserve(MAX_PAGES / 8);
+    fuzz_dirty_list = reserve(MAX_PAGES * sizeof(uint32_t));
+
+    intrinsic_init();
+    load_program();
+    fclose(program);
+    program = NULL;
+
+    save_machine(&boot);
+    word_size = WIDE ? sizeof(uint32_t) : sizeof(uint16_t);
+    snapshot = reserve((WIDE ? 0x100000000ULL : 0x10000ULL) * word_size);
+    core = machine_range(0, 0);
+    for (i = 0; i < fuzz_dirty_count; i++)
+        memcpy(snapshot + (size_t) fuzz_dirty_list[i] * PAGE_WORDS * word_size,
+               core + (size_t) fuzz_dirty_list[i] * PAGE_WORDS * word_size,
+               PAGE_WORDS * word_size);
+    reset();
+    coverage_map = counters;
+    return 0;
+}
+
+
+/* LLVMFuzzerTestOneInput() - run the program once on 'data' */
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    size_t i, words;
+
+    input = data;
+    input_size = size;
+    input_next = 0;
+
+    words = size / word_size;
+    if (DISK_WORDS < words)
+        words = DISK_WORDS;
+    memset(disk, 0, disk_used * sizeof(uint32_t));
+    for (i = 0; i < words; i++)
+        disk[i] = (2 == word_size) ? data[i * 2] | data[i * 2 + 1] << 8
+                                   : data[i * 4] | data[i * 4 + 1] << 8 | data[i * 4 + 2] << 16
+                                     | (uint32_t) data[i * 4 + 3] << 24;
+    disk_used = words;
+
+    memset(&stats, 0, sizeof(stats));
+    load_machine(&boot);
+    coverage_last = 0;
+
+    running = true;
+    if (0 == setjmp(run_end))
+        run_machine();
+    running = false;
+
+    reset();
+    return 0;
+}
+
+
+/* fuzz_exit() - finish() for the harness: the end of a run goes back to
+   the harness, while a failure outside a run ends the process
+*/
+void fuzz_exit(char* description, EXITTYPE result)
+{
+    if (running)
+        longjmp(run_end, 1);
+    fprintf(stderr, "%s\n", description);
+    exit(result);
+}
+
+
+int fuzz_tty_read()
+{
+    return (input_next < input_size) ? input[input_next++] : EOF;
+}
+
+
+uint32_t fuzz_disk_read(uint64_t seek)
+{
+    return (seek < DISK_WORDS) ? disk[seek] : 0;
+}
+
+
+void fuzz_disk_write(uint64_t seek, uint32_t value)
+{
+    if (seek < DISK_WORDS)
+    {
+        disk[seek] = value;
+        if (seek >= disk_used)
+            disk_used = seek + 1;
+    }
+}
+
+
+/* reset() - put back the pages written since the last reset */
+static void reset()
+{
+    char* core = machine_range(0, 0);
+    size_t offset;
+    uint32_t i, page;
+
+    for (i = 0; i < fuzz_dirty_count; i++)
+    {
+        page = fuzz_dirty_list[i];
+        offset = (size_t) page * PAGE_WORDS * word_size;
+        memcpy(core + offset, snapshot + offset, PAGE_WORDS * word_size);
+        fuzz_dirty_map[page / 64] = 0;
+    }
+    fuzz_dirty_count = 0;
+}
+
+
+/* reserve() - address space the host only commits as it is touched */
+static void* reserve(size_t size)
+{
+    void* region;
+
+    region = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (MAP_FAILED == region)
+        fuzz_exit("Could not reserve harness memory", FAIL);
+    return region;
+}
@@ -0,0 +1,76 @@
+/* fuzz.h
+ * version 00.01.00
+ * Copyright (C) 2011  Joseph Osako
+ * This file is part of Pmac-Passim.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef FUZZ_H
+#define FUZZ_H
+
+#include <stdint.h>
+#include "pmac.h"
+
+/* The in-process fuzzing harness (see fuzz.c) is built with PMAC_FUZZ
+   defined; in pmac itself the hooks below compile to nothing. */
+
+#ifdef PMAC_FUZZ
+
+#define FUZZ_PAGE_SHIFT  8              // 256 words to a page of memory
+#define FUZZ_STEPS       1000000        // instructions before a run counts as hung
+
+extern uint64_t* fuzz_dirty_map;        // a bit for each page written since the reset
+extern uint32_t* fuzz_dirty_list;       // and the same pages in a list
+extern uint32_t fuzz_dirty_count;
+
+void fuzz_exit(char* description, EXITTYPE result);
+int fuzz_tty_read(void);
+uint32_t fuzz_disk_read(uint64_t seek);
+void fuzz_disk_write(uint64_t seek, uint32_t value);
+
+/* fuzz_dirty() - note that the page holding 'address' has been written */
+static inline void fuzz_dirty(uint32_t address)
+{
+    uint32_t page = address >> FUZZ_PAGE_SHIFT;
+    uint64_t bit = 1ULL << (page % 64);
+
+    if (0 == (fuzz_dirty_map[page / 64] & bit))
+    {
+        fuzz_dirty_map[page / 64] |= bit;
+        fuzz_dirty_list[fuzz_dirty_count++] = page;
+    }
+}
+
+static inline void fuzz_dirty_range(uint32_t address, uint32_t count)
+{
+    uint64_t page, last = ((uint64_t) address + count - 1) >> FUZZ_PAGE_SHIFT;
+
+    if (0 < count)
+        for (page = address >> FUZZ_PAGE_SHIFT; page <= last; page++)
+            fuzz_dirty(page << FUZZ_PAGE_SHIFT);
+}
+
+#define FUZZ_DIRTY(address)              fuzz_dirty(address)
+#define FUZZ_DIRTY_RANGE(address, count) fuzz_dirty_range((address), (count))
+
+#else
+
+#define FUZZ_DIRTY(address)
+#define FUZZ_DIRTY_RANGE(address, count)
+
+#endif
+
+#endif
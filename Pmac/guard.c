@@ -0,0 +1,145 @@
+/* guard.c - stack guard pages for pmac.
+ * '-l <words>' makes the top host page of the machine's memory, and the
+ * page below the deepest the stack may reach, PROT_NONE, and starts the
+ * stack pointer at the first word of the top page. push() and pop() are
+ * left as they are: a push past the limit, or a pop from the empty stack,
+ * touches a guard page, and the fault handler here reports it as a stack
+ * overflow or underflow, in place of the stack quietly wrapping round or
+ * running down over the program and its data. The limit is rounded up to
+ * whole host pages, and the words of the guard pages are lost to the
+ * program; any access to them is reported the same way.
+ *
+ * A fault while finish() is already reporting the end of the machine,
+ * such as the register dump reading the word at a stray stack pointer,
+ * only opens the page, so that the report goes on.
+ *
+ * version 00.01.00
+ * Copyright (C) 2011  Joseph Osako
+ * This file is part of Pmac-Passim.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "pmac.h"
+#include "guard.h"
+
+/* where the guard pages fall in a machine's memory, in words */
+typedef struct
+{
+    uint64_t page_words;
+    uint64_t below;             // the first word of the guard under the stack
+    uint64_t above;             // the first word of the guard over it
+} LAYOUT;
+
+uint32_t guard_limit = 0;
+
+static bool installed = false;
+
+static void layout(bool wide, LAYOUT* guard);
+static void on_fault(int number, siginfo_t* info, void* context);
+
+
+bool guard_active()
+{
+    return 0 < guard_limit;
+}
+
+
+/* guard_place() - close the guard pages of a newly reserved memory and
+   give the top of its stack
+*/
+uint32_t guard_place(void* memory, bool wide)
+{
+    struct sigaction action;
+    size_t word = wide ? sizeof(uint32_t) : sizeof(uint16_t);
+    char* base = memory;
+    LAYOUT guard;
+
+    layout(wide, &guard);
+    if (0 != mprotect(base + guard.below * word, guard.page_words * word, PROT_NONE)
+        || 0 != mprotect(base + guard.above * word, guard.page_words * word, PROT_NONE))
+        finish("Could not place the stack guard pages", FAIL);
+
+    if (!installed)
+    {
+        memset(&action, 0, sizeof(action));
+        action.sa_flags = SA_SIGINFO;
+        sigemptyset(&action.sa_mask);
+        action.sa_sigaction = on_fault;
+        sigaction(SIGSEGV, &action, NULL);
+        installed = true;
+    }
+    return guard.above;
+}
+
+
+/* layout() - the top page of memory guards the top of the stack, and the
+   page under the limit, rounded down to a page boundary, the bottom.
+   The stack top is the first word of the top page, which push() never
+   writes, as it moves the stack pointer first.
+*/
+static void layout(bool wide, LAYOUT* guard)
+{
+    uint64_t words = wide ? 0x100000000ULL : 0x10000ULL;
+    uint64_t bottom;
+
+    guard->page_words = sysconf(_SC_PAGESIZE) / (wide ? sizeof(uint32_t) : sizeof(uint16_t));
+    guard->above = words - guard->page_words;
+    if (guard->above < (uint64_t) guard_limit + guard->page_words)
+        finish("Stack limit too large", FAIL);
+    bottom = (guard->above - guard_limit) & ~(guard->page_words - 1);
+    guard->below = bottom - guard->page_words;
+}
+
+
+/* on_fault() - report a touch of a guard page of the running machine.
+   The page is opened for reading first, so that the register dump can
+   show the word at the stack pointer, and the read is simply made again
+   if the fault came from a report already under way. Any other fault
+   takes its course.
+*/
+static void on_fault(int number, siginfo_t* info, void* context)
+{
+    size_t word = WIDE ? sizeof(uint32_t) : sizeof(uint16_t);
+    char* base = machine_range(0, 1);
+    char* address = info->si_addr;
+    uint64_t offset;
+    LAYOUT guard;
+
+    (void) context;
+    layout(WIDE, &guard);
+    offset = (uint64_t) (address - base) / word;
+    if (address >= base && guard.below <= offset && offset < guard.below + guard.page_words)
+    {
+        mprotect(base + guard.below * word, guard.page_words * word, PROT_READ);
+        if (!finishing)
+            finish("Stack overflow", FAIL);
+        return;
+    }
+    if (address >= base && guard.above <= offset && offset < guard.above + guard.page_words)
+    {
+        mprotect(base + guard.above * word, guard.page_words * word, PROT_READ);
+        if (!finishing)
+            finish("Stack underflow", FAIL);
+        return;
+    }
+    signal(number, SIG_DFL);
+}
@@ -0,0 +1,32 @@
+/* guard.h
+ * version 00.01.00
+ * Copyright (C) 2011  Joseph Osako
+ * This file is part of Pmac-Passim.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef GUARD_H
+#define GUARD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+extern uint32_t guard_limit;    // the words the stack may hold, 0 for no guard pages
+
+bool guard_active(void);
+uint32_t guard_place(void* memory, bool wide);
+
+#endif
@@ -0,0 +1,246 @@
+/* heap.c - the heap service for pmac programs.
+ * HEAP hands the allocator a region of the machine's memory, and ALLOC,
+ * FREE and RESIZE then work on blocks within it. The region starts with
+ * the allocator's own header, so that the heap belongs to the machine
+ * and goes wherever its memory goes:
+ *     base + 0     HEAP_MAGIC
+ *     base + 1     size of the region, in words
+ *     base + 2     the words from base up to the first never yet handed
+ *                  out, an offset so that it cannot wrap to 0 when the
+ *                  region ends at the top of a 16-bit memory
+ *     base + 3...  the free list of each size class
+ * A block is a power of two words, its first word holding its size
+ * class (with HEAP_FREE set while it is free) and the rest going to the
+ * program; a free block keeps the next block of its free list in its
+ * second word. ALLOC takes a block off the free list of its class, or
+ * failing that from the untouched end of the region, and only when both
+ * are empty splits a block of a larger class; FREE puts the block back
+ * on its list. Blocks are not merged again, which suits programs that
+ * reuse blocks of the same few sizes.
+ *
+ * On the cores of an SMP run, the heap is shared; each core runs HEAP
+ * with the same region, and the first to do so sets it up.
+ *
+ * version 00.01.00
+ * Copyright (C) 2011  Joseph Osako
+ * This file is part of Pmac-Passim.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "pmac.h"
+#include "heap.h"
+#include "smp.h"
+#include "stats.h"
+
+#define HEAP_MAGIC    0x4850    // "HP"
+#define HEAP_CLASSES  32        // blocks of 2 to 2^31 words
+#define HEAP_FREE     0x80      // set in the class word of a free block
+
+/* the header words */
+#define MAGIC_WORD    0
+#define SIZE_WORD     1
+#define TOP_WORD      2
+#define LISTS         3
+#define HEADER_WORDS  (LISTS + HEAP_CLASSES)
+
+static uint32_t base(void);
+static int size_class(uint32_t size);
+static uint32_t take(int class);
+static void give(uint32_t block, int class);
+
+
+/* heap_create() - set up the heap, or join the one already there */
+void heap_create(uint32_t address, uint32_t size)
+{
+    uint32_t i;
+
+    if (HEADER_WORDS + 2 > size)
+        finish("Heap too small", FAIL);
+    machine_range(address, size);
+
+    smp_lock();
+    if (HEAP_MAGIC != machine_load(address + MAGIC_WORD)
+        || size != machine_load(address + SIZE_WORD))
+    {
+        machine_store(address + SIZE_WORD, size);
+        machine_store(address + TOP_WORD, HEADER_WORDS);
+        for (i = 0; i < HEAP_CLASSES; i++)
+            machine_store(address + LISTS + i, 0);
+        machine_store(address + MAGIC_WORD, HEAP_MAGIC);
+    }
+    smp_unlock();
+    machine_set_heap(address);
+}
+
+
+uint32_t heap_alloc(uint32_t size)
+{
+    uint32_t block;
+    int class = size_class(size);
+
+    smp_lock();
+    block = (0 <= class) ? take(class) : 0;
+    smp_unlock();
+
+    if (0 == block)
+    {
+        stats.heap_failures++;
+        return 0;
+    }
+    stats.heap_allocs++;
+    stats.heap_words += (uint64_t) 1 << class;
+    return block + 1;
+}
+
+
+void heap_free(uint32_t address)
+{
+    uint32_t block = address - 1;
+    uint32_t class;
+
+    if (0 == address)
+        return;
+
+    /* the top moves as other cores allocate, so check under the lock */
+    smp_lock();
+    if (block < base() + HEADER_WORDS
+        || block >= (uint64_t) base() + machine_load(base() + TOP_WORD))
+        finish("Free of an address outside the heap", FAIL);
+    class = machine_load(block);
+    if (0 != (class & HEAP_FREE) || HEAP_CLASSES <= class)
+        finish("Free of a block which is not allocated", FAIL);
+    give(block, class);
+    smp_unlock();
+
+    stats.heap_frees++;
+    stats.heap_words -= (uint64_t) 1 << class;
+}
+
+
+/* heap_resize() - a block that has room already stays where it is;
+   otherwise the words move to a new block. If there is no room for
+   that, the old block is left as it was and 0 is returned.
+*/
+uint32_t heap_resize(uint32_t address, uint32_t size)
+{
+    uint32_t class, words, moved;
+    void* from;
+    void* to;
+
+    if (0 == address)
+        return heap_alloc(size);
+
+    stats.heap_resizes++;
+    class = machine_load(address - 1);
+    if (0 != (class & HEAP_FREE) || HEAP_CLASSES <= class)
+        finish("Resize of a block which is not allocated", FAIL);
+    words = ((uint32_t) 1 << class) - 1;
+    if (size <= words)
+        return address;
+
+    if (0 == (moved = heap_alloc(size)))
+        return 0;
+    from = machine_range(address, words);
+    to = machine_range(moved, words);
+    memcpy(to, from, words * (WIDE ? 4 : 2));
+    heap_free(address);
+    return moved;
+}
+
+
+static uint32_t base()
+{
+    if (0 == machine_heap())
+        finish("No heap has been set up", FAIL);
+    return machine_heap();
+}
+
+
+/* size_class() - the smallest class with room for the size and the
+   class word; -1 if there is none
+*/
+static int size_class(uint32_t size)
+{
+    int class = 1;
+
+    while (class < HEAP_CLASSES && ((uint64_t) 1 << class) < (uint64_t) size + 1)
+        class++;
+    return (HEAP_CLASSES > class) ? class : -1;
+}
+
+
+/* take() - a block of the class, from its free list, from the top of
+   the heap, or by splitting a larger free block; 0 if there is none
+*/
+static uint32_t take(int class)
+{
+    uint32_t heap = base();
+    uint32_t block, buddy;
+    uint64_t used, size;
+    int larger;
+
+    block = machine_load(heap + LISTS + class);
+    if (0 != block)
+    {
+        machine_store(heap + LISTS + class, machine_load(block + 1));
+        machine_store(block, class);
+        return block;
+    }
+
+    used = machine_load(heap + TOP_WORD);
+    size = machine_load(heap + SIZE_WORD);
+    if (((uint64_t) 1 << class) <= size - used)
+    {
+        block = heap + used;
+        used += (uint64_t) 1 << class;
+        machine_store(heap + TOP_WORD, used);
+        if (used > stats.heap_high_water)
+            stats.heap_high_water = used;
+        machine_store(block, class);
+        return block;
+    }
+
+    for (larger = class + 1; larger < HEAP_CLASSES; larger++)
+    {
+        block = machine_load(heap + LISTS + larger);
+        if (0 == block)
+            continue;
+        machine_store(heap + LISTS + larger, machine_load(block + 1));
+        /* keep the front half, freeing the back half at each step */
+        while (larger > class)
+        {
+            larger--;
+            buddy = block + ((uint32_t) 1 << larger);
+            give(buddy, larger);
+        }
+        machine_store(block, class);
+        return block;
+    }
+    return 0;
+}
+
+
+static void give(uint32_t block, int class)
+{
+    uint32_t list = base() + LISTS + class;
+
+    machine_store(block, class | HEAP_FREE);
+    machine_store(block + 1, machine_load(list));
+    machine_store(list, block);
+}
@@ -0,0 +1,31 @@
+/* heap.h
+ * version 00.01.00
+ * Copyright (C) 2011  Joseph Osako
+ * This file is part of Pmac-Passim.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef HEAP_H
+#define HEAP_H
+
+#include <stdint.h>
+
+void heap_create(uint32_t base, uint32_t size);
+uint32_t heap_alloc(uint32_t size);
+void heap_free(uint32_t address);
+uint32_t heap_resize(uint32_t address, uint32_t size);
+
+#endif
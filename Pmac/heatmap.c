@@ -0,0 +1,346 @@
+/* heatmap.c - memory access heatmaps for pmac.
+ * With '-m <file>', the machine counts the accesses to each bucket of
+ * addresses - one word, or the number of words given with '-g' - kept
+ * apart as instruction fetches, data reads and writes through addresses
+ * the program gives, and stack reads and writes, which take in pushes,
+ * pops and the frame. At the end of the run every bucket used is written
+ * to <file> as a line of text, and the hottest ranges of buckets in a
+ * row are listed, by the labels of the program when '-y' names the
+ * symbol map passim wrote for it.
+ *
+ * The counters of a wide machine are kept for buckets of no fewer than
+ * 1024 words, to keep the table to 4M buckets.
+ *
+ * version 00.01.00
+ * Copyright (C) 2011  Joseph Osako
+ * This file is part of Pmac-Passim.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "pmac.h"
+#include "heatmap.h"
+
+#define MAX_BUCKETS  (1U << 22)
+#define HOT_RANGES   8
+#define SYMBOL_NAME  32
+
+typedef struct
+{
+    uint32_t value;
+    char name[SYMBOL_NAME];
+} SYMBOL;
+
+/* a run of buckets in a row that were all used */
+typedef struct
+{
+    uint64_t first, last;       // addresses of the first and last words
+    uint64_t counts[HEAT_KINDS];
+    uint64_t total;
+} RANGE;
+
+char* heat_path = NULL;
+char* symbol_path = NULL;
+uint32_t heat_bucket = 0;       // words to a bucket, 0 for the fewest the width allows
+uint64_t (*heat_map)[HEAT_KINDS] = NULL;
+
+/* The traffic of each instruction, which heat_step() in interp.h counts
+   before the instruction runs. The first row also stands for any opcode
+   not listed, which counts only its fetch.
+*/
+const HEAT_EFFECT heat_effects[] = {
+    /* op       args pops pushes  target         kind          modify */
+    {HALT,      0, 0, 0,  NOWHERE,       HEAT_FETCH,       false},
+    {PUSH,      1, 0, 1,  NOWHERE,       HEAT_FETCH,       false},
+    {PUSHI,     2, 0, 1,  AT_INDEX,      HEAT_DATA_READ,   false},
+    {PUSHR,     0, 1, 1,  AT_TOP,        HEAT_DATA_READ,   false},
+    {PUSHA,     1, 0, 1,  AT_ARG,        HEAT_DATA_READ,   false},
+    {PUSHO,     0, 1, 1,  AT_FRAME_TOP,  HEAT_STACK_READ,  false},
+    {PUSHF,     0, 0, 1,  NOWHERE,       HEAT_FETCH,       false},
+    {PUSHS,     0, 0, 1,  NOWHERE,       HEAT_FETCH,       false},
+    {PUSHP,     0, 0, 1,  NOWHERE,       HEAT_FETCH,       false},
+    {PUSHZ,     0, 0, 1,  NOWHERE,       HEAT_FETCH,       false},
+    {DUP,       0, 0, 1,  AT_SP,         HEAT_STACK_READ,  false},
+    {LOADL,     1, 0, 1,  AT_FRAME_ARG,  HEAT_STACK_READ,  false},
+    {POPA,      1, 1, 0,  AT_ARG,        HEAT_DATA_WRITE,  false},
+    {POPI,      2, 1, 0,  AT_INDEX,      HEAT_DATA_WRITE,  false},
+    {POPR,      0, 2, 0,  AT_TOP,        HEAT_DATA_WRITE,  false},
+    {POPO,      0, 2, 0,  AT_FRAME_TOP,  HEAT_STACK_WRITE, false},
+    {POPF,      0, 1, 0,  NOWHERE,       HEAT_FETCH,       false},
+    {POPS,      0, 1, 0,  NOWHERE,       HEAT_FETCH,       false},
+    {DROP,      0, 1, 0,  NOWHERE,       HEAT_FETCH,       false},
+    {SWAP,      0, 0, 0,  AT_SWAP,       HEAT_STACK_READ,  true},
+    {STOREL,    1, 1, 0,  AT_FRAME_ARG,  HEAT_STACK_WRITE, false},
+    {BRA,       1, 0, 0,  NOWHERE,       HEAT_FETCH,       false},
+    {BRI,       2, 0, 0,  AT_INDEX_WORD, HEAT_DATA_READ,   false},
+    {BRZ,       1, 1, 0,  NOWHERE,       HEAT_FETCH,       false},
+    {BNZ,       1, 1, 0,  NOWHERE,       HEAT_FETCH,       false},
+    {BEQ,       2, 1, 0,  NOWHERE,       HEAT_FETCH,       false},
+    {BNE,       2, 1, 0,  NOWHERE,       HEAT_FETCH,       false},
+    {BLT,       2, 1, 0,  NOWHERE,       HEAT_FETCH,       false},
+    {BGE,       2, 1, 0,  NOWHERE,       HEAT_FETCH,       false},
+    {BEQA,      2, 1, 0,  AT_ARG,        HEAT_DATA_READ,   false},
+    {BNEA,      2, 1, 0,  AT_ARG,        HEAT_DATA_READ,   false},
+    {BLTA,      2, 1, 0,  AT_ARG,        HEAT_DATA_READ,   false},
+    {BGEA,      2, 1, 0,  AT_ARG,        HEAT_DATA_READ,   false},
+    {DBNZ,      2, 0, 0,  AT_ARG,        HEAT_DATA_READ,   true},
+    {BSR,       1, 0, 1,  NOWHERE,       HEAT_FETCH,       false},
+    {RTS,       0, 1, 0,  NOWHERE,       HEAT_FETCH,       false},
+    {ENTER,     1, 0, 1,  NOWHERE,       HEAT_FETCH,       false},
+    {LEAVE,     0, 0, 0,  AT_FP,         HEAT_STACK_READ,  false},
+    {EQL,       0, 2, 1,  NOWHERE,       HEAT_FETCH,       false},
+    {NEQ,       0, 2, 1,  NOWHERE,       HEAT_FETCH,       false},
+    {LES,       0, 2, 1,  NOWHERE,       HEAT_FETCH,       false},
+    {LEQ,       0, 2, 1,  NOWHERE,       HEAT_FETCH,       false},
+    {GRE,       0, 2, 1,  NOWHERE,       HEAT_FETCH,       false},
+    {GEQ,       0, 2, 1,  NOWHERE,       HEAT_FETCH,       false},
+    {ADD,       0, 2, 1,  NOWHERE,       HEAT_FETCH,       false},
+    {INC,       0, 1, 1,  NOWHERE,       HEAT_FETCH,       false},
+    {SUB,       0, 2, 1,  NOWHERE,       HEAT_FETCH,       false},
+    {DEC,       0, 1, 1,  NOWHERE,       HEAT_FETCH,       false},
+    {MUL,       0, 2, 1,  NOWHERE,       HEAT_FETCH,       false},
+    {DIV,       0, 2, 1,  NOWHERE,       HEAT_FETCH,       false},
+    {MOD,       0, 2, 1,  NOWHERE,       HEAT_FETCH,       false},
+    {SHL,       0, 2, 1,  NOWHERE,       HEAT_FETCH,       false},
+    {ROL,       0, 2, 1,  NOWHERE,       HEAT_FETCH,       false},
+    {SHR,       0, 2, 1,  NOWHERE,       HEAT_FETCH,       false},
+    {ROR,       0, 2, 1,  NOWHERE,       HEAT_FETCH,       false},
+    {IOR,       0, 2, 1,  NOWHERE,       HEAT_FETCH,       false},
+    {XOR,       0, 2, 1,  NOWHERE,       HEAT_FETCH,       false},
+    {AND,       0, 2, 1,  NOWHERE,       HEAT_FETCH,       false},
+    {NOT,       0, 1, 1,  NOWHERE,       HEAT_FETCH,       false},
+    {POPCNT,    0, 1, 1,  NOWHERE,       HEAT_FETCH,       false},
+    {CLZ,       0, 1, 1,  NOWHERE,       HEAT_FETCH,       false},
+    {CTZ,       0, 1, 1,  NOWHERE,       HEAT_FETCH,       false},
+    {BSWAP,     0, 1, 1,  NOWHERE,       HEAT_FETCH,       false},
+    {IN,        0, 0, 0,  AT_PORT,       HEAT_DATA_WRITE,  false},
+    {OUT,       0, 0, 0,  AT_PORT,       HEAT_DATA_READ,   false},
+    {DADD,      0, 4, 2,  NOWHERE,       HEAT_FETCH,       false},
+    {DSUB,      0, 4, 2,  NOWHERE,       HEAT_FETCH,       false},
+    {DMUL,      0, 4, 2,  NOWHERE,       HEAT_FETCH,       false},
+    {DCMP,      0, 4, 1,  NOWHERE,       HEAT_FETCH,       false},
+    {DSHL,      0, 3, 2,  NOWHERE,       HEAT_FETCH,       false},
+    {DSHR,      0, 3, 2,  NOWHERE,       HEAT_FETCH,       false},
+    {QMUL,      0, 2, 1,  NOWHERE,       HEAT_FETCH,       false},
+    {QDIV,      0, 2, 1,  NOWHERE,       HEAT_FETCH,       false},
+    {QSQRT,     0, 1, 1,  NOWHERE,       HEAT_FETCH,       false},
+    {QADD,      0, 2, 1,  NOWHERE,       HEAT_FETCH,       false},
+    {QSUB,      0, 2, 1,  NOWHERE,       HEAT_FETCH,       false},
+    {CAS,       0, 3, 1,  AT_DEEPEST,    HEAT_DATA_READ,   true},
+    {AADD,      0, 2, 1,  AT_DEEPEST,    HEAT_DATA_READ,   true},
+    {CPUID,     0, 0, 1,  NOWHERE,       HEAT_FETCH,       false},
+    {NCPU,      0, 0, 1,  NOWHERE,       HEAT_FETCH,       false},
+    {CALLN,     1, 0, 0,  NOWHERE,       HEAT_FETCH,       false},  // the intrinsic counts its own
+    {HEAP,      0, 2, 0,  NOWHERE,       HEAT_FETCH,       false},
+    {ALLOC,     0, 1, 1,  NOWHERE,       HEAT_FETCH,       false},
+    {FREE,      0, 1, 0,  NOWHERE,       HEAT_FETCH,       false},
+    {RESIZE,    0, 2, 1,  NOWHERE,       HEAT_FETCH,       false}
+};
+
+#define HEAT_EFFECTS (sizeof(heat_effects) / sizeof(heat_effects[0]))
+
+uint8_t heat_effect_index[0x10000];     // the row of each opcode, 0 if none
+int heat_shift = 0;
+
+static uint64_t buckets;
+static SYMBOL* symbols = NULL;
+static int symbol_count = 0;
+
+static void read_symbols(void);
+static int by_value(const void* a, const void* b);
+static void rank(RANGE* hot, int* count, const RANGE* range);
+static void print_range(const RANGE* range);
+
+
+/* heat_open() - size the counters for the loaded machine */
+void heat_open()
+{
+    uint64_t words = WIDE ? 0x100000000ULL : 0x10000ULL;
+    void* region;
+    size_t i;
+
+    if (0 == heat_bucket)
+        heat_bucket = (words > MAX_BUCKETS) ? words / MAX_BUCKETS : 1;
+    if (0 != (heat_bucket & (heat_bucket - 1)) || heat_bucket > words
+        || words / heat_bucket > MAX_BUCKETS)
+        finish("The heatmap bucket must be a power of two, and 1024 words or more on a wide machine", FAIL);
+
+    for (heat_shift = 0; (1U << heat_shift) < heat_bucket; heat_shift++)
+        ;
+    buckets = words >> heat_shift;
+
+    /* only the pages of counters actually used are ever committed */
+    region = mmap(NULL, buckets * sizeof(*heat_map), PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (MAP_FAILED == region)
+        finish("Could not reserve the heatmap", FAIL);
+    heat_map = region;
+
+    for (i = 1; i < HEAT_EFFECTS; i++)
+        heat_effect_index[heat_effects[i].op] = i;
+
+    if (NULL != symbol_path)
+        read_symbols();
+}
+
+
+/* heat_write() - write the heatmap and list the hottest ranges */
+void heat_write()
+{
+    uint64_t (*map)[HEAT_KINDS] = heat_map;
+    RANGE hot[HOT_RANGES], range;
+    FILE* out;
+    uint64_t b, total;
+    int i, count = 0;
+
+    if (NULL == map)
+        return;
+    heat_map = NULL;    // nothing more is counted from here
+
+    if (NULL == (out = fopen(heat_path, "w")))
+    {
+        puts("Could not create heatmap file");
+        return;
+    }
+    fprintf(out, "# %u word buckets: address fetch data_read data_write stack_read stack_write\n",
+            heat_bucket);
+
+    range.total = 0;
+    for (b = 0; b < buckets; b++)
+    {
+        for (total = 0, i = 0; i < HEAT_KINDS; i++)
+            total += map[b][i];
+        if (0 == total)
+        {
+            rank(hot, &count, &range);
+            range.total = 0;
+            continue;
+        }
+
+        fprintf(out, WIDE ? "%08llx" : "%04llx", (unsigned long long) (b << heat_shift));
+        for (i = 0; i < HEAT_KINDS; i++)
+            fprintf(out, " %llu", (unsigned long long) map[b][i]);
+        fputc('\n', out);
+
+        if (0 == range.total)
+        {
+            memset(&range, 0, sizeof(range));
+            range.first = b << heat_shift;
+        }
+        range.last = ((b + 1) << heat_shift) - 1;
+        for (i = 0; i < HEAT_KINDS; i++)
+            range.counts[i] += map[b][i];
+        range.total += total;
+    }
+    rank(hot, &count, &range);
+    fclose(out);
+
+    puts("Hottest memory ranges:");
+    for (i = 0; i < count; i++)
+        print_range(&hot[i]);
+    puts("");
+}
+
+
+/* read_symbols() - read a symbol map from 'passim -y': a label to a
+   line, its value in hex followed by its name
+*/
+static void read_symbols()
+{
+    FILE* map;
+    SYMBOL symbol;
+    int size = 0;
+
+    if (NULL == (map = fopen(symbol_path, "r")))
+        finish("Symbol map not found", FAIL);
+    while (2 == fscanf(map, "%x %31s", &symbol.value, symbol.name))
+    {
+        if (symbol_count == size)
+        {
+            size = (0 == size) ? 64 : size * 2;
+            if (NULL == (symbols = realloc(symbols, size * sizeof(SYMBOL))))
+                finish("Out of memory", FAIL);
+        }
+        symbols[symbol_count++] = symbol;
+    }
+    fclose(map);
+    qsort(symbols, symbol_count, sizeof(SYMBOL), by_value);
+}
+
+
+static int by_value(const void* a, const void* b)
+{
+    uint32_t x = ((const SYMBOL*) a)->value, y = ((const SYMBOL*) b)->value;
+
+    return (x > y) - (x < y);
+}
+
+
+/* rank() - keep the range if it is among the hottest so far */
+static void rank(RANGE* hot, int* count, const RANGE* range)
+{
+    int i;
+
+    if (0 == range->total)
+        return;
+    if (HOT_RANGES == *count && range->total <= hot[HOT_RANGES - 1].total)
+        return;
+    if (HOT_RANGES > *count)
+        (*count)++;
+    for (i = *count - 1; 0 < i && hot[i - 1].total < range->total; i--)
+        hot[i] = hot[i - 1];
+    hot[i] = *range;
+}
+
+
+/* print_range() - one line of the summary, with the label at or below
+   the start of the range when there is a symbol map
+*/
+static void print_range(const RANGE* range)
+{
+    int low = 0, high = symbol_count - 1, middle, found = -1;
+
+    printf(WIDE ? "  %08llx-%08llx" : "  %04llx-%04llx",
+           (unsigned long long) range->first, (unsigned long long) range->last);
+    printf("  total %llu  fetch %llu  data %llu/%llu  stack %llu/%llu",
+           (unsigned long long) range->total,
+           (unsigned long long) range->counts[HEAT_FETCH],
+           (unsigned long long) range->counts[HEAT_DATA_READ],
+           (unsigned long long) range->counts[HEAT_DATA_WRITE],
+           (unsigned long long) range->counts[HEAT_STACK_READ],
+           (unsigned long long) range->counts[HEAT_STACK_WRITE]);
+
+    while (low <= high)
+    {
+        middle = (low + high) / 2;
+        if (symbols[middle].value <= range->first)
+        {
+            found = middle;
+            low = middle + 1;
+        }
+        else
+            high = middle - 1;
+    }
+    if (0 <= found && symbols[found].value == range->first)
+        printf("  %s", symbols[found].name);
+    else if (0 <= found)
+        printf("  %s+%llx", symbols[found].name,
+               (unsigned long long) (range->first - symbols[found].value));
+    putchar('\n');
+}
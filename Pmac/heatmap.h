@@ -0,0 +1,96 @@
+/* heatmap.h
+ * version 00.01.00
+ * Copyright (C) 2011  Joseph Osako
+ * This file is part of Pmac-Passim.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef HEATMAP_H
+#define HEATMAP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* the kinds of memory access counted for each bucket of addresses */
+typedef enum {
+    HEAT_FETCH,                         // instructions and their arguments
+    HEAT_DATA_READ, HEAT_DATA_WRITE,    // through addresses the program gives
+    HEAT_STACK_READ, HEAT_STACK_WRITE,  // pushes, pops, and the frame
+    HEAT_KINDS
+} HEAT_KIND;
+
+/* where an instruction's one addressed access falls, if it has one */
+typedef enum {
+    NOWHERE,
+    AT_ARG,             // the address given as its argument
+    AT_INDEX,           // the argument indexed by the word at the second
+    AT_INDEX_WORD,      // just the index word
+    AT_TOP,             // the address on top of the stack
+    AT_FRAME_TOP,       // the frame pointer plus the top of the stack
+    AT_FRAME_ARG,       // the frame pointer plus the argument
+    AT_SP,              // the top of the stack itself
+    AT_FP,              // the frame pointer itself
+    AT_DEEPEST,         // the address deepest among the words popped
+    AT_SWAP,            // the top two words of the stack
+    AT_PORT             // depends on the port (see heat_step())
+} HEAT_TARGET;
+
+/* the memory traffic of an instruction besides the fetch of its opcode */
+typedef struct
+{
+    uint32_t op;
+    uint8_t args, pops, pushes;     // words of argument, popped and pushed
+    uint8_t target;                 // HEAT_TARGET
+    uint8_t kind;                   // HEAT_KIND of the access at the target
+    bool modify;                    // the target is read, then written
+} HEAT_EFFECT;
+
+extern const HEAT_EFFECT heat_effects[];
+extern uint8_t heat_effect_index[0x10000];
+
+extern char* heat_path;
+extern char* symbol_path;
+extern uint32_t heat_bucket;
+extern uint64_t (*heat_map)[HEAT_KINDS];
+extern int heat_shift;
+
+void heat_open(void);
+void heat_write(void);
+
+/* heat_count() - count one access, when the heatmap is on */
+static inline void heat_count(uint32_t address, HEAT_KIND kind)
+{
+    if (__builtin_expect(NULL != heat_map, 0))
+        heat_map[address >> heat_shift][kind]++;
+}
+
+/* heat_effect() - the traffic of an opcode, from the table in heatmap.c */
+static inline const HEAT_EFFECT* heat_effect(uint32_t op)
+{
+    return &heat_effects[(op < 0x10000) ? heat_effect_index[op] : 0];
+}
+
+/* heat_modify() - a read of the word followed by a write of it */
+static inline void heat_modify(uint32_t address, HEAT_KIND read)
+{
+    if (__builtin_expect(NULL != heat_map, 0))
+    {
+        heat_map[address >> heat_shift][read]++;
+        heat_map[address >> heat_shift][read + 1]++;
+    }
+}
+
+#endif
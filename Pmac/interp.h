@@ -0,0 +1,1382 @@
+/* interp.h - the pmac machine proper, generated once per word width.
+ * pmac.c includes this file twice, once with PMAC_WIDTH defined as 16
+ * and once as 32. Each inclusion produces a complete machine - memory,
+ * registers, interpreter and I/O - whose names carry a _16 or _32
+ * suffix, so that both widths come from the same source.
+ * version 00.01.00
+ * Copyright (C) 2011  Joseph Osako
+ * This file is part of Pmac-Passim.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#if 16 == PMAC_WIDTH
+#define WORD        uint16_t
+#define DWORD       uint32_t    // a pair of words
+#define MAXMEM      0x10000ULL
+#define WFMT        "%4x"
+#elif 32 == PMAC_WIDTH
+#define WORD        uint32_t
+#define DWORD       uint64_t
+#define MAXMEM      0x100000000ULL
+#define WFMT        "%8x"
+#else
+#error "PMAC_WIDTH must be either 16 or 32"
+#endif
+
+/* every external name gets the width as a suffix */
+#define memory          PER_WIDTH_NAME(memory)
+#define ip              PER_WIDTH_NAME(ip)
+#define sp              PER_WIDTH_NAME(sp)
+#define fp              PER_WIDTH_NAME(fp)
+#define stack_top       PER_WIDTH_NAME(stack_top)
+#define heap_base       PER_WIDTH_NAME(heap_base)
+#define init_machine    PER_WIDTH_NAME(init_machine)
+#define save_machine    PER_WIDTH_NAME(save_machine)
+#define load_machine    PER_WIDTH_NAME(load_machine)
+#define dumpregs        PER_WIDTH_NAME(dumpregs)
+#define stack_word      PER_WIDTH_NAME(stack_word)
+#define read_program    PER_WIDTH_NAME(read_program)
+#define trace           PER_WIDTH_NAME(trace)
+#define interp          PER_WIDTH_NAME(interp)
+#define push            PER_WIDTH_NAME(push)
+#define pop             PER_WIDTH_NAME(pop)
+#define push_double     PER_WIDTH_NAME(push_double)
+#define pop_double      PER_WIDTH_NAME(pop_double)
+#define argument        PER_WIDTH_NAME(argument)
+#define index_arg       PER_WIDTH_NAME(index_arg)
+#define input           PER_WIDTH_NAME(input)
+#define output          PER_WIDTH_NAME(output)
+#define block_length    PER_WIDTH_NAME(block_length)
+#define memory_range    PER_WIDTH_NAME(memory_range)
+#define fused_branch    PER_WIDTH_NAME(fused_branch)
+#define heat_step       PER_WIDTH_NAME(heat_step)
+#define display_program PER_WIDTH_NAME(display_program)
+
+
+/* simulated memory and registers, one set for each host thread */
+_Thread_local WORD* memory = NULL;
+
+_Thread_local WORD ip = 0;           // instruction pointer
+_Thread_local WORD sp = MAXMEM - 1;  // stack pointer, initialized to the top of memory
+_Thread_local WORD fp = MAXMEM - 1;  // frame pointer, initially matches the stack pointer
+_Thread_local WORD stack_top = MAXMEM - 1;   // where the stack started
+_Thread_local WORD heap_base = 0;            // the heap set up by HEAP, 0 for none
+
+
+/* function prototypes */
+void init_machine(void);
+void save_machine(MACHINE* m);
+void load_machine(const MACHINE* m);
+void dumpregs(void);
+void read_program(void);
+void trace(char *inst, WORD op);
+void interp(void);
+WORD stack_word(void);
+void push(WORD val);
+WORD pop(void);
+void push_double(DWORD val);
+DWORD pop_double(void);
+WORD argument(void);
+WORD index_arg(void);
+void input(void);
+void output(void);
+WORD block_length(WORD address, WORD count);
+void fused_branch(bool taken);
+void heat_step(WORD op);
+void* memory_range(uint32_t address, uint32_t count);
+void display_program(void);
+
+
+/* init_machine() - reserve the address space for the machine's memory.
+   Pages are only committed by the host as they are first touched, so
+   a wide machine costs no more than the memory its program uses.
+*/
+void init_machine()
+{
+    memory = reserve_memory(MAXMEM * sizeof(WORD));
+    ip = 0;
+    sp = fp = stack_top = MAXMEM - 1;
+    if (guard_active())
+        sp = fp = stack_top = guard_place(memory, 4 == sizeof(WORD));
+    heap_base = 0;
+}
+
+
+void save_machine(MACHINE* m)
+{
+    m->core = memory;
+    m->ip_reg = ip;
+    m->sp_reg = sp;
+    m->fp_reg = fp;
+    m->top_reg = stack_top;
+    m->heap_reg = heap_base;
+}
+
+void load_machine(const MACHINE* m)
+{
+    memory = m->core;
+    ip = m->ip_reg;
+    sp = m->sp_reg;
+    fp = m->fp_reg;
+    stack_top = m->top_reg;
+    heap_base = m->heap_reg;
+}
+
+
+// dumpregs() - display the registers as a line of text
+void dumpregs()
+{
+    printf("Registers: IP:" WFMT "   SP:" WFMT "   FP:" WFMT "   TOS:" WFMT "\n\n",
+           ip, sp, fp, stack_word());
+}
+
+/* stack_word() - the top of the stack, for display. With guard pages the
+   top of an empty stack is the first word of a guard (see guard.c), and
+   shows as 0.
+*/
+WORD stack_word()
+{
+    return (sp == stack_top && guard_active()) ? 0 : memory[sp];
+}
+
+void read_program()
+{
+    unsigned long long i;
+    unsigned int value;
+
+    for (i = 0; !feof(program) && !ferror(program) && i < MAXMEM; i++)
+    {
+        if (1 == fscanf(program, WFMT, &value) && (i < code_from || i >= code_to))
+        {
+            memory[i] = value;
+            FUZZ_DIRTY(i);
+        }
+    }
+}
+
+void trace(char *inst, WORD op)
+{
+    if (TRACE)
+    {
+        printf("Inst: %s  Opcode: %4x\n", inst, op);
+        dumpregs();
+        getchar();
+    }
+
+}
+
+void interp()
+{
+    WORD op;
+    WORD temp;
+    DWORD dtemp, dleft;
+    WORD address, expected;
+
+    do
+    {
+        op = memory[ip];
+        stats.retired++;
+        stats.classes[(op >> 8) & (OPCODE_CLASSES - 1)]++;
+        if (NULL != trace_ring)
+            trace_record(ip, op, sp, fp, stack_word());
+        if (NULL != heat_map)
+            heat_step(op);
+#ifdef PMAC_FUZZ
+        if (FUZZ_STEPS < stats.retired)
+            finish("Instruction limit reached", FAIL);  // a hung input ends its run
+#endif
+
+dispatch:
+        switch(op)
+        {
+            case HALT:
+                PROBE2(halt, ip, stats.retired);
+                trace("HALT", op);
+                finish("Execution halted.", SUCCEED);
+                break;
+            case PUSH:      /* push immediate */
+                temp = argument();
+                push(temp);
+                if (TRACE)
+                {
+                    printf("Inst: PUSH #" WFMT "  Opcode: %4x\n",
+                           temp, op);
+                    dumpregs();
+                    getchar();
+                }
+                break;
+            case PUSHI:     /* push indexed */
+                temp = index_arg();
+                push(memory[temp]);
+                if(TRACE)
+                {
+                    printf("Inst: PUSH " WFMT "[" WFMT "]  Opcode: %4x Index: " WFMT "\n I",
+                           memory[ip-1], memory[ip], op, memory[memory[ip]]);
+                    dumpregs();
+                    getchar();
+                }
+                break;
+            case PUSHR:     /* push indirect from stack */
+                temp = pop();
+                push(memory[temp]);
+                trace("PUSHR", op);
+                break;
+            case PUSHA:     /* push indirect from argument */
+                temp = argument();
+                push(memory[temp]);
+                if(TRACE)
+                {
+                    printf("Inst: PUSHA " WFMT "  Opcode: %4x\n", temp, op);
+                    dumpregs();
+                    getchar();
+                }
+                break;
+            case PUSHO:     /* push from frame pointer offset */
+                temp = pop();
+                push(memory[(WORD) (fp + temp)]);
+                trace("PUSHO", op);
+                break;
+            case LOADL:     /* push from the frame offset given by the argument */
+                temp = argument();
+                push(memory[(WORD) (fp + temp)]);
+                trace("LOADL", op);
+                break;
+            case PUSHF:     /* push frame pointer */
+                push(fp);
+                trace("PUSHF", op);
+                break;
+            case PUSHS:     /* push stack pointer */
+                push(sp);
+                trace("PUSHS", op);
+                break;
+            case PUSHP:     /* push instruction pointer */
+                push(ip);
+                trace("PUSHP", op);
+                break;
+            case PUSHZ:     /* push zero */
+                push(0);
+                trace("PUSHZ", op);
+                break;
+            case DUP:     /* push zero */
+                push(memory[sp]);
+                trace("DUP", op);
+                break;
+            case POPA:
+                temp = argument();
+                memory[temp] = pop();
+                FUZZ_DIRTY(temp);
+                if(TRACE)
+                {   temp = memory[ip];
+                    printf("Inst: POP " WFMT " Opcode: %4x Target: " WFMT "\n",
+                            temp, op, memory[temp]);
+                    dumpregs();
+                    getchar();
+                }
+                break;
+            case POPI:
+                temp = index_arg();
+                memory[temp] = pop();
+                FUZZ_DIRTY(temp);
+                if(TRACE)
+                {
+                    temp = memory[ip] + memory[ip + 1];
+                    printf("Inst: POP " WFMT "[" WFMT "]  Opcode: %4x Target: " WFMT "\n",
+                            memory[ip], memory[ip-1], op, temp);
+                    dumpregs();
+                    getchar();
+                }
+                break;
+            case POPO:
+                temp = pop();
+                memory[(WORD) (fp + temp)] = pop();
+                FUZZ_DIRTY((WORD) (fp + temp));
+                trace("POPO", op);
+                break;
+            case STOREL:    /* pop to the frame offset given by the argument */
+                temp = argument();
+                memory[(WORD) (fp + temp)] = pop();
+                FUZZ_DIRTY((WORD) (fp + temp));
+                trace("STOREL", op);
+                break;
+            case POPR:
+                temp = pop();
+                memory[temp] = pop();
+                FUZZ_DIRTY(temp);
+                trace("POPR", op);
+                break;
+            case POPF:
+                fp = pop();
+                trace("POPF", op);
+                break;
+            case POPS:
+                sp = pop();
+                trace("POPS", op);
+                break;
+            case DROP:
+                (void) *(volatile WORD*) &memory[sp++];  /* a real read, for the stack guard */
+                trace("DROP", op);
+                break;
+            case SWAP:
+                temp = memory[sp];
+                memory[sp] = memory[(WORD) (sp - 1)];
+                memory[(WORD) (sp - 1)] = temp;
+                FUZZ_DIRTY(sp);
+                FUZZ_DIRTY((WORD) (sp - 1));
+                trace("SWAP", op);
+                break;
+
+            /* branch */
+            case BRA:
+                ip = argument();
+                stats.branches++;
+                if (NULL != coverage_map)
+                    coverage_edge(ip);
+                if(TRACE)
+                {
+                    printf("Inst: BRA " WFMT " Opcode: %4x\n", memory[ip], op);
+                    dumpregs();
+                    getchar();
+                }
+                break;
+            case BRI:
+                ip = index_arg();
+                stats.branches++;
+                if (NULL != coverage_map)
+                    coverage_edge(ip);
+                if(TRACE)
+                {
+                    printf("Inst: BRI " WFMT "[" WFMT "]  Opcode: %4x\n", memory[ip], memory[ip-1], op);
+                    dumpregs();
+                    getchar();
+                }
+                break;
+            /* conditional branch */
+            case BRZ:
+                temp = pop();
+                if (0 == temp)
+                {
+                    ip = argument();
+                    stats.branches++;
+                }
+                else
+                   ip += 2;
+                if (NULL != coverage_map)
+                    coverage_edge(ip);
+                if(TRACE)
+                {
+                    printf("Inst: BRZ " WFMT " Opcode: %4x\n", memory[ip], op);
+                    dumpregs();
+                    getchar();
+                }
+                break;
+            case BNZ:
+                temp = pop();
+                if (0 != temp)
+                {
+                    ip = argument();
+                    stats.branches++;
+                }
+                else
+                   ip += 2;
+                if (NULL != coverage_map)
+                    coverage_edge(ip);
+                if(TRACE)
+                {
+                    printf("Inst: BNZ " WFMT " Opcode: %4x\n", memory[ip], op);
+                    dumpregs();
+                    getchar();
+                }
+                break;
+            /* call and return */
+            /* fused compare and branch - the top of stack against the
+               first argument, or the word it addresses; the target is
+               the second */
+            case BEQ:
+                temp = pop();
+                fused_branch(temp == argument());
+                trace("BEQ", op);
+                break;
+            case BNE:
+                temp = pop();
+                fused_branch(temp != argument());
+                trace("BNE", op);
+                break;
+            case BLT:
+                temp = pop();
+                fused_branch(temp < argument());
+                trace("BLT", op);
+                break;
+            case BGE:
+                temp = pop();
+                fused_branch(temp >= argument());
+                trace("BGE", op);
+                break;
+            case BEQA:
+                temp = pop();
+                fused_branch(temp == memory[argument()]);
+                trace("BEQA", op);
+                break;
+            case BNEA:
+                temp = pop();
+                fused_branch(temp != memory[argument()]);
+                trace("BNEA", op);
+                break;
+            case BLTA:
+                temp = pop();
+                fused_branch(temp < memory[argument()]);
+                trace("BLTA", op);
+                break;
+            case BGEA:
+                temp = pop();
+                fused_branch(temp >= memory[argument()]);
+                trace("BGEA", op);
+                break;
+            case DBNZ:      /* decrement the counter at the address, branch unless it is now zero */
+                temp = argument();
+                FUZZ_DIRTY(temp);
+                fused_branch(0 != --memory[temp]);
+                trace("DBNZ", op);
+                break;
+            case BSR:
+                push(ip);
+                ip = argument();
+                PROBE2(bsr, ip, sp);
+                stats.branches++;
+                if (NULL != coverage_map)
+                    coverage_edge(ip);
+                if(TRACE)
+                {
+                    printf("Inst: BSR " WFMT " Opcode: %4x\n", memory[ip], op);
+                    dumpregs();
+                    getchar();
+                }
+                break;
+            case RTS:
+                ip = pop();
+                PROBE2(rts, ip, sp);
+                stats.branches++;
+                if (NULL != coverage_map)
+                    coverage_edge(ip);
+                trace("RTS", op);
+                break;
+            case ENTER:     /* save the frame pointer and make room for the argument's count of locals */
+                temp = argument();
+                push(fp);
+                fp = sp;
+                sp -= temp;
+                if ((WORD) (stack_top - sp) > stats.stack_depth)
+                    stats.stack_depth = (WORD) (stack_top - sp);    // as push() does
+                trace("ENTER", op);
+                break;
+            case LEAVE:     /* drop the locals and restore the caller's frame */
+                sp = fp;
+                fp = pop();
+                trace("LEAVE", op);
+                break;
+            /* comparisons */
+                break;
+            case EQL:
+                temp = pop();
+                push(pop() == temp ? 1 : 0);
+                trace("EQL", op);
+                break;
+            case NEQ:
+                temp = pop();
+                push(pop() == temp ? 0 : 1);
+                trace("NEQ", op);
+                break;
+            case LES:
+                temp = pop();
+                push(temp < pop() ? 0 : 1);
+                trace("NEQ", op);
+                break;
+            case LEQ:
+                temp = pop();
+                push(temp <= pop() ? 0 : 1);
+                trace("LEQ", op);
+                break;
+            case GRE:
+                temp = pop();
+                push(temp > pop() ? 0 : 1);
+                trace("GRE", op);
+                break;
+            case GEQ:
+                temp = pop();
+                push(temp >= pop() ? 0 : 1);
+                trace("GEQ", op);
+                break;
+            case ADD:
+                push(pop() + pop());
+                trace("ADD", op);
+                break;
+            case INC:
+                (memory[sp])++;
+                FUZZ_DIRTY(sp);
+                trace("INC", op);
+                break;
+            case SUB:
+                push(pop() - pop());
+                trace("SUB", op);
+                break;
+            case DEC:
+                (memory[sp])--;
+                FUZZ_DIRTY(sp);
+                trace("DEC", op);
+                break;
+            case MUL:
+                push(pop() * pop());
+                trace("MUL", op);
+                break;
+            case DIV:
+                temp = pop();
+                if (0 == temp)
+                    finish("Divide by Zero Error", FAIL);
+                else
+                    push(pop() / temp);
+                trace("DIV", op);
+                break;
+            case MOD:
+                temp = pop();
+                push(pop() % temp);
+                trace("MOD", op);
+                break;
+             /* shift operators */
+            case SHL:
+                memory[sp] <<= pop();
+                FUZZ_DIRTY(sp);
+                trace("SHL", op);
+                break;
+            case SHR:
+                memory[sp] >>= pop();
+                FUZZ_DIRTY(sp);
+                trace("SHR", op);
+                break;
+            /* rotates, by the count on top modulo the word width */
+            case ROL:
+                temp = pop() & (sizeof(WORD) * 8 - 1);
+                memory[sp] = (WORD) (memory[sp] << temp) | (WORD) (memory[sp] >> (-temp & (sizeof(WORD) * 8 - 1)));
+                FUZZ_DIRTY(sp);
+                trace("ROL", op);
+                break;
+            case ROR:
+                temp = pop() & (sizeof(WORD) * 8 - 1);
+                memory[sp] = (WORD) (memory[sp] >> temp) | (WORD) (memory[sp] << (-temp & (sizeof(WORD) * 8 - 1)));
+                FUZZ_DIRTY(sp);
+                trace("ROR", op);
+                break;
+            case IOR:
+                memory[sp] |= pop();
+                FUZZ_DIRTY(sp);
+                trace("IOR", op);
+                break;
+            case XOR:
+                memory[sp] ^= pop();
+                FUZZ_DIRTY(sp);
+                trace("XOR", op);
+                break;
+            case AND:
+                memory[sp] &= pop();
+                FUZZ_DIRTY(sp);
+                trace("AND", op);
+                break;
+            case NOT:
+                memory[sp] = ~memory[sp];
+                FUZZ_DIRTY(sp);
+                trace("NOT", op);
+                break;
+            /* bit counts; the zero counts of 0 are the word width */
+            case POPCNT:
+                memory[sp] = __builtin_popcount(memory[sp]);
+                FUZZ_DIRTY(sp);
+                trace("POPCNT", op);
+                break;
+            case CLZ:
+                memory[sp] = (0 == memory[sp]) ? (WORD) (sizeof(WORD) * 8)
+                           : (WORD) (__builtin_clz(memory[sp]) - (32 - sizeof(WORD) * 8));
+                FUZZ_DIRTY(sp);
+                trace("CLZ", op);
+                break;
+            case CTZ:
+                memory[sp] = (0 == memory[sp]) ? (WORD) (sizeof(WORD) * 8) : (WORD) __builtin_ctz(memory[sp]);
+                FUZZ_DIRTY(sp);
+                trace("CTZ", op);
+                break;
+            case BSWAP:
+                memory[sp] = (2 == sizeof(WORD)) ? __builtin_bswap16(memory[sp])
+                           : __builtin_bswap32(memory[sp]);
+                FUZZ_DIRTY(sp);
+                trace("BSWAP", op);
+                break;
+            case IN:
+                input();
+                break;
+            case OUT:
+                output();
+                break;
+            /* atomics, for cores sharing memory (see smp.c) */
+            case CAS:       /* address, expected, new value - pushes 1 if swapped */
+                temp = pop();
+                expected = pop();
+                address = pop();
+                FUZZ_DIRTY(address);
+                push(__atomic_compare_exchange_n(&memory[address], &expected, temp, false,
+                                                 __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST));
+                trace("CAS", op);
+                break;
+            case AADD:      /* address, addend - pushes the old value */
+                temp = pop();
+                address = pop();
+                FUZZ_DIRTY(address);
+                push(__atomic_fetch_add(&memory[address], temp, __ATOMIC_SEQ_CST));
+                trace("AADD", op);
+                break;
+            case CPUID:
+                push(smp_core());
+                trace("CPUID", op);
+                break;
+            case NCPU:
+                push(smp_count());
+                trace("NCPU", op);
+                break;
+            case BARRIER:
+                smp_barrier();
+                trace("BARRIER", op);
+                break;
+            case CALLN:     /* call the host intrinsic given by the argument */
+                intrinsic_call(argument());
+                trace("CALLN", op);
+                break;
+            /* the heap service (see heap.c) */
+            case HEAP:      /* base, size */
+                temp = pop();
+                heap_create(pop(), temp);
+                trace("HEAP", op);
+                break;
+            case ALLOC:     /* size - pushes the address, or 0 */
+                push(heap_alloc(pop()));
+                trace("ALLOC", op);
+                break;
+            case FREE:      /* address */
+                heap_free(pop());
+                trace("FREE", op);
+                break;
+            case RESIZE:    /* address, size - pushes the new address, or 0 */
+                temp = pop();
+                push(heap_resize(pop(), temp));
+                trace("RESIZE", op);
+                break;
+            /* double word arithmetic - the deeper pair is the left operand */
+            case DADD:
+                dtemp = pop_double();
+                push_double(pop_double() + dtemp);
+                trace("DADD", op);
+                break;
+            case DSUB:
+                dtemp = pop_double();
+                push_double(pop_double() - dtemp);
+                trace("DSUB", op);
+                break;
+            case DMUL:
+                dtemp = pop_double();
+                push_double(pop_double() * dtemp);
+                trace("DMUL", op);
+                break;
+            case DCMP:      /* -1, 0 or 1 as the left pair is below, equal to or above the right */
+                dtemp = pop_double();
+                dleft = pop_double();
+                push((dleft < dtemp) ? (WORD) -1 : (dleft > dtemp) ? 1 : 0);
+                trace("DCMP", op);
+                break;
+            case DSHL:      /* the count is a single word on top of the pair */
+                temp = pop();
+                dtemp = pop_double();
+                push_double((temp < sizeof(DWORD) * 8) ? dtemp << temp : 0);
+                trace("DSHL", op);
+                break;
+            case DSHR:
+                temp = pop();
+                dtemp = pop_double();
+                push_double((temp < sizeof(DWORD) * 8) ? dtemp >> temp : 0);
+                trace("DSHR", op);
+                break;
+            /* fixed point, with half of the word after the point (see fixed.c) */
+            case QMUL:
+                temp = pop();
+                push(fixed_mul(pop(), temp));
+                trace("QMUL", op);
+                break;
+            case QDIV:
+                temp = pop();
+                push(fixed_div(pop(), temp));
+                trace("QDIV", op);
+                break;
+            case QSQRT:
+                push(fixed_sqrt(pop()));
+                trace("QSQRT", op);
+                break;
+            case QADD:      /* saturating */
+                temp = pop();
+                push(fixed_add(pop(), temp));
+                trace("QADD", op);
+                break;
+            case QSUB:
+                temp = pop();
+                push(fixed_sub(pop(), temp));
+                trace("QSUB", op);
+                break;
+            case BRK:       /* a breakpoint - run the instruction it covers */
+                op = debug_break(ip);   // which also counts it in place of the BRK
+                if (NULL != heat_map)
+                    heat_step(op);
+                goto dispatch;
+            default:
+                break;    /* do nothing */
+        }
+        /* branches set the IP themselves, conditional ones whether taken or not */
+        if (op != BRA && (op >> 8) != (BRZ >> 8) && op != BSR && op != RTS && op != HALT)
+        {
+            ip++;
+        }
+    } while (1);
+
+}
+
+void push(WORD value)
+{
+    memory[--sp] = value;
+    FUZZ_DIRTY(sp);
+    if ((WORD) (stack_top - sp) > stats.stack_depth)
+        stats.stack_depth = (WORD) (stack_top - sp);
+}
+
+WORD pop()
+{
+    return memory[sp++];
+}
+
+/* a double word is pushed low word first, leaving the high word on top */
+void push_double(DWORD value)
+{
+    push((WORD) value);
+    push((WORD) (value >> (sizeof(WORD) * 8)));
+}
+
+DWORD pop_double()
+{
+    DWORD high = pop();
+
+    return (high << (sizeof(WORD) * 8)) | pop();
+}
+
+WORD argument()
+{
+    ip++;
+    return memory[ip];
+}
+
+WORD index_arg()
+{
+    WORD base, index;
+
+    base = argument();
+    index = argument();
+    return (base + memory[index]);
+}
+
+
+void output()
+{
+    WORD port, seek, value;
+    DWORD dseek;
+
+    port = seek = value = 0;
+
+    port = pop();
+
+    switch(port)
+    {
+        case TTY:
+            value = pop();
+            tty_write((char) value);
+            break;
+        case FDD:
+            seek = pop();
+            value = pop();
+            fdd_write(seek, value);
+            break;
+        case FDDX:
+            dseek = pop_double();
+            seek = (WORD) dseek;
+            value = pop();
+            fdd_write(dseek, value);
+            break;
+        default:
+            if (CHANNEL_PORT <= port && port < CHANNEL_PORT + CHANNELS)
+            {
+                value = pop();
+                channel_write(port - CHANNEL_PORT, value);
+                break;
+            }
+            if (BLOCK_PORT <= port && port < BLOCK_PORT + CHANNELS)
+            {
+                seek = pop();       // the address of the block
+                value = block_length(seek, pop());
+                channel_send(port - BLOCK_PORT, &memory[seek], value);
+                break;
+            }
+            if (TRACE)
+            {
+                printf("Inst: OUT  Opcode: %4x  Port: " WFMT "  Seek: " WFMT "  Value: " WFMT "\n",
+                       OUT, port, seek, value);
+                       dumpregs();
+                       getchar();
+            }
+            finish("Invalid output port", FAIL);
+            break;
+    }
+    PROBE3(out, port, seek, value);
+    if (TRACE)
+    {
+        printf("Inst: OUT  Opcode: %4x  Port: " WFMT "  Seek: " WFMT "  Value: " WFMT "\n",
+               OUT, port, seek, value);
+        dumpregs();
+        getchar();
+    }
+
+}
+
+void input()
+{
+    WORD port, seek = 0, value = 0;
+    DWORD dseek;
+
+    port = pop();
+    switch (port)
+    {
+        case TTY:
+            push(tty_read());
+            break;
+        case FDD:
+            seek = pop();
+            value = fdd_read(seek);
+            push(value);
+            break;
+        case FDDX:      /* the seek is a double word */
+            dseek = pop_double();
+            seek = (WORD) dseek;
+            value = fdd_read(dseek);
+            push(value);
+            break;
+        case RETIRED:   /* this machine's instructions so far, as a double word */
+            push_double(aio_active() ? aio_retired() : stats.retired);
+            break;
+        case CLOCK:     /* the host clock in microseconds, as a double word */
+            push_double(clock_read());
+            break;
+        default:
+            if (CHANNEL_PORT <= port && port < CHANNEL_PORT + CHANNELS)
+            {
+                value = channel_read(port - CHANNEL_PORT);
+                push(value);
+                break;
+            }
+            if (BLOCK_PORT <= port && port < BLOCK_PORT + CHANNELS)
+            {
+                seek = pop();       // the address of the block
+                value = block_length(seek, pop());
+                push(channel_receive(port - BLOCK_PORT, &memory[seek], value));
+                break;
+            }
+            if (TRACE)
+            {
+                printf("Inst: OUT  Opcode: %4x  Port: " WFMT "  Seek: " WFMT "  Value: " WFMT "\n",
+                       OUT, port, seek, value);
+                dumpregs();
+                getchar();
+            }
+            finish("Invalid input port", FAIL);
+            break;
+    }
+    PROBE3(in, port, seek, memory[sp]);
+    if (TRACE)
+    {
+        printf("Inst: OUT  Opcode: %4x  Port: " WFMT "  Seek: " WFMT "  Value: " WFMT "\n",
+               OUT, port, seek, value);
+        dumpregs();
+        getchar();
+    }
+
+}
+
+/* fused_branch() - finish a compare-and-branch, with the IP on its
+   first argument
+*/
+void fused_branch(bool taken)
+{
+    if (taken)
+    {
+        ip = argument();
+        stats.branches++;
+    }
+    else
+        ip += 2;
+    if (NULL != coverage_map)
+        coverage_edge(ip);
+}
+
+/* memory_range() - the words from 'address' on, if all 'count' of them are in memory */
+void* memory_range(uint32_t address, uint32_t count)
+{
+    if ((uint64_t) address + count > MAXMEM)
+        finish("Range outside memory", FAIL);
+    FUZZ_DIRTY_RANGE(address, count);   // the caller may write to it
+    return &memory[address];
+}
+
+/* heat_step() - count the memory accesses the instruction at the IP is
+   about to make, for the heatmap (see heatmap.c), as its row of the
+   effect table gives them. Working them out here leaves the instructions
+   themselves as they are, with one test of the heatmap for each
+   instruction when it is off.
+*/
+void heat_step(WORD op)
+{
+    const HEAT_EFFECT* effect = heat_effect(op);
+    WORD top = stack_word();
+    WORD first = memory[(WORD) (ip + 1)], second = memory[(WORD) (ip + 2)];
+    WORD address = 0, count;
+    uint32_t pops = effect->pops, pushes = effect->pushes, i;
+
+    if (BRK == op)
+        return;     // the BRK case counts the instruction it covers instead
+
+    switch (effect->target)
+    {
+        case AT_ARG:
+            address = first;
+            break;
+        case AT_INDEX:
+            heat_count(second, HEAT_DATA_READ);
+            address = first + memory[second];
+            break;
+        case AT_INDEX_WORD:
+            address = second;
+            break;
+        case AT_TOP:
+            address = top;
+            break;
+        case AT_FRAME_TOP:
+            address = fp + top;
+            break;
+        case AT_FRAME_ARG:
+            address = fp + first;
+            break;
+        case AT_SP:
+            address = sp;
+            break;
+        case AT_FP:
+            address = fp;
+            break;
+        case AT_DEEPEST:
+            address = memory[(WORD) (sp + pops - 1)];
+            break;
+        case AT_SWAP:   /* as the instruction has it, the word below the stack */
+            heat_modify((WORD) (sp - 1), effect->kind);
+            address = sp;
+            break;
+        case AT_PORT:   /* what is on the stack depends on the port */
+            pops = (FDD == top) ? 2 : (FDDX == top) ? 3 : 1;
+            if (BLOCK_PORT <= top && top < BLOCK_PORT + CHANNELS)
+            {
+                pops = 3;
+                address = memory[(WORD) (sp + 1)];
+                count = block_length(address, memory[(WORD) (sp + 2)]);
+                for (i = 0; i < count; i++)
+                    heat_count((WORD) (address + i), effect->kind);
+            }
+            else if (OUT == op)
+                pops++;     // the word written
+            if (IN == op)
+                pushes = (RETIRED == top || CLOCK == top) ? 2 : 1;
+            break;
+        default:
+            break;
+    }
+    if (NOWHERE != effect->target && AT_PORT != effect->target)
+    {
+        if (effect->modify)
+            heat_modify(address, effect->kind);
+        else
+            heat_count(address, effect->kind);
+    }
+
+    for (i = 0; i <= effect->args; i++)
+        heat_count((WORD) (ip + i), HEAT_FETCH);
+    for (i = 0; i < pops; i++)
+        heat_count((WORD) (sp + i), HEAT_STACK_READ);
+    for (i = 0; i < pushes; i++)
+        heat_count((WORD) (sp + pops - 1 - i), HEAT_STACK_WRITE);
+}
+
+/* block_length() - a block transfer stops at the end of memory */
+WORD block_length(WORD address, WORD count)
+{
+    return (count > MAXMEM - address) ? (WORD) (MAXMEM - address) : count;
+}
+
+void display_program()
+{
+    WORD op;
+   /* WORD temp; */
+
+    puts("\nProgram Listing:");
+    do
+    {
+        op = memory[ip];
+
+        switch(op)
+        {
+            case HALT:
+                puts("HALT");
+                break;
+            case PUSH:      /* push immediate */
+                ip++;
+                printf("PUSH #" WFMT "\n", memory[ip]);
+                break;
+            case PUSHI:     /* push indexed */
+                ip += 2;
+                printf("PUSH " WFMT "[" WFMT "]\n", memory[ip - 1], memory[ip]);
+                break;
+            case PUSHA:     /* push indirect */
+                ip++;
+                printf("PUSH " WFMT "\n", memory[ip]);
+                break;
+            case PUSHR:     /* push indirect from stack */
+                puts("PUSHR");
+                break;
+            case PUSHO:
+                puts("PUSHO");
+                break;
+            case LOADL:
+                ip++;
+                printf("LOADL #" WFMT "\n", memory[ip]);
+                break;
+            case PUSHF:     /* push frame pointer */
+                puts("PUSHF");
+                break;
+            case PUSHS:     /* push stack pointer */
+                puts("PUSHS");
+                break;
+            case PUSHP:     /* push instruction pointer */
+                puts("PUSHP");
+                break;
+            case PUSHZ:     /* push zero */
+                puts("PUSHZ");
+                break;
+            case DUP:     /* push zero */
+                puts("DUP");
+                break;
+            case POPA:
+                ip++;
+                printf("POP " WFMT "\n", memory[ip]);
+                break;
+            case POPI:
+                ip += 2;
+                printf("POP " WFMT "[" WFMT "]\n", memory[ip - 1], memory[ip]);
+                break;
+            case POPO:
+                puts("POPO");
+                break;
+            case STOREL:
+                ip++;
+                printf("STOREL #" WFMT "\n", memory[ip]);
+                break;
+            case POPR:
+                puts("POPR");
+                break;
+            case POPF:
+                puts("POPF");
+                break;
+            case POPS:
+                puts("POPS");
+                break;
+            case DROP:
+                puts("DROP");
+                break;
+            case SWAP:
+                puts("SWAP");
+                break;
+            /* branch */
+            case BRA:
+                ip++;
+                printf("BRA " WFMT "\n", memory[ip]);
+                break;
+            case BRI:
+                ip += 2;
+                printf("BRI " WFMT "[" WFMT "]\n", memory[ip - 1], memory[ip]);
+                break;
+            /* conditional branch */
+            case BRZ:
+                ip++;
+                printf("BRZ " WFMT "\n", memory[ip]);
+                break;
+            case BNZ:
+                ip++;
+                printf("BNZ " WFMT "\n", memory[ip]);
+                break;
+            /* call and return */
+            case BEQ:
+                ip += 2;
+                printf("BEQ #" WFMT " " WFMT "\n", memory[ip - 1], memory[ip]);
+                break;
+            case BNE:
+                ip += 2;
+                printf("BNE #" WFMT " " WFMT "\n", memory[ip - 1], memory[ip]);
+                break;
+            case BLT:
+                ip += 2;
+                printf("BLT #" WFMT " " WFMT "\n", memory[ip - 1], memory[ip]);
+                break;
+            case BGE:
+                ip += 2;
+                printf("BGE #" WFMT " " WFMT "\n", memory[ip - 1], memory[ip]);
+                break;
+            case BEQA:
+                ip += 2;
+                printf("BEQA " WFMT " " WFMT "\n", memory[ip - 1], memory[ip]);
+                break;
+            case BNEA:
+                ip += 2;
+                printf("BNEA " WFMT " " WFMT "\n", memory[ip - 1], memory[ip]);
+                break;
+            case BLTA:
+                ip += 2;
+                printf("BLTA " WFMT " " WFMT "\n", memory[ip - 1], memory[ip]);
+                break;
+            case BGEA:
+                ip += 2;
+                printf("BGEA " WFMT " " WFMT "\n", memory[ip - 1], memory[ip]);
+                break;
+            case DBNZ:
+                ip += 2;
+                printf("DBNZ " WFMT " " WFMT "\n", memory[ip - 1], memory[ip]);
+                break;
+            case BSR:
+                ip++;
+                printf("BSR " WFMT "\n", memory[ip]);
+                break;
+            case RTS:
+                puts("RTS");
+                break;
+            case ENTER:
+                ip++;
+                printf("ENTER #" WFMT "\n", memory[ip]);
+                break;
+            case LEAVE:
+                puts("LEAVE");
+                break;
+            /* comparisons */
+                break;
+            case EQL:
+                puts("EQL");
+                break;
+            case NEQ:
+                puts("NEQ");
+                break;
+            case LES:
+                puts("NEQ");
+                break;
+            case LEQ:
+                puts("LEQ");
+                break;
+            case GRE:
+                puts("GRE");
+                break;
+            case GEQ:
+                puts("GEQ");
+                break;
+            case ADD:
+                puts("ADD");
+                break;
+            case INC:
+                puts("INC");
+                break;
+            case SUB:
+                puts("SUB");
+                break;
+            case DEC:
+                puts("DEC");
+                break;
+            case MUL:
+                puts("MUL");
+                break;
+            case DIV:
+                puts("DIV");
+                break;
+            case MOD:
+                puts("MOD");
+                break;
+             /* shift operators */
+            case SHL:
+                puts("SHL");
+                break;
+            case SHR:
+                puts("SHR");
+                break;
+            case IOR:
+                puts("IOR");
+                break;
+            case XOR:
+                puts("XOR");
+                break;
+            case AND:
+                puts("AND");
+                break;
+            case NOT:
+                puts("NOT");
+                break;
+            case POPCNT:
+                puts("POPCNT");
+                break;
+            case CLZ:
+                puts("CLZ");
+                break;
+            case CTZ:
+                puts("CTZ");
+                break;
+            case BSWAP:
+                puts("BSWAP");
+                break;
+            case ROL:
+                puts("ROL");
+                break;
+            case ROR:
+                puts("ROR");
+                break;
+            case IN:
+                puts("IN");
+                break;
+            case OUT:
+                puts("OUT");
+                break;
+            case DADD:
+                puts("DADD");
+                break;
+            case DSUB:
+                puts("DSUB");
+                break;
+            case DMUL:
+                puts("DMUL");
+                break;
+            case DCMP:
+                puts("DCMP");
+                break;
+            case DSHL:
+                puts("DSHL");
+                break;
+            case DSHR:
+                puts("DSHR");
+                break;
+            case QMUL:
+                puts("QMUL");
+                break;
+            case QDIV:
+                puts("QDIV");
+                break;
+            case QSQRT:
+                puts("QSQRT");
+                break;
+            case QADD:
+                puts("QADD");
+                break;
+            case QSUB:
+                puts("QSUB");
+                break;
+            case CALLN:
+                ip++;
+                printf("CALLN #" WFMT "\n", memory[ip]);
+                break;
+            case HEAP:
+                puts("HEAP");
+                break;
+            case ALLOC:
+                puts("ALLOC");
+                break;
+            case FREE:
+                puts("FREE");
+                break;
+            case RESIZE:
+                puts("RESIZE");
+                break;
+            case CAS:
+                puts("CAS");
+                break;
+            case AADD:
+                puts("AADD");
+                break;
+            case CPUID:
+                puts("CPUID");
+                break;
+            case NCPU:
+                puts("NCPU");
+                break;
+            case BARRIER:
+                puts("BARRIER");
+                break;
+            default:
+                break;    /* do nothing */
+        }
+        ip++;
+    } while (HALT != op);
+    /* reset values to start point */
+    ip = 0;
+    sp = fp = stack_top;    // below the top guard page, if there is one
+    puts("\n");
+}
+
+
+#undef display_program
+#undef output
+#undef block_length
+#undef memory_range
+#undef heat_step
+#undef fused_branch
+#undef input
+#undef index_arg
+#undef argument
+#undef pop_double
+#undef push_double
+#undef pop
+#undef push
+#undef interp
+#undef trace
+#undef read_program
+#undef stack_word
+#undef dumpregs
+#undef load_machine
+#undef save_machine
+#undef init_machine
+#undef fp
+#undef stack_top
+#undef heap_base
+#undef sp
+#undef ip
+#undef memory
+
+#undef WFMT
+#undef MAXMEM
+#undef DWORD
+#undef WORD
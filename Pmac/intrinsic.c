@@ -0,0 +1,167 @@
+/* intrinsic.c - routines of the host which pmac programs can call.
+ * 'CALLN n' runs intrinsic n, a C function which takes its arguments
+ * off the machine's stack, works directly on the words of its memory,
+ * and pushes its results. The built-in intrinsics, with their stack
+ * arguments in the order they are pushed, are:
+ *     0  sort range      address, count              ->
+ *     1  hash range      address, count              -> hash
+ *     2  binary search   address, count, key         -> index, or all ones
+ *     3  format decimal  value, address              -> length
+ * The sort and search treat the words as unsigned. The hash is FNV-1a
+ * over the words, folded to the word width. The decimal digits are
+ * written one character to a word, as the TTY takes them.
+ *
+ * A program embedding pmac adds its own intrinsics by defining
+ * intrinsic_extensions(), which is called once at start-up, and calling
+ * intrinsic_register() from it with numbers not already taken.
+ *
+ * version 00.01.00
+ * Copyright (C) 2011  Joseph Osako
+ * This file is part of Pmac-Passim.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "pmac.h"
+#include "intrinsic.h"
+
+typedef struct
+{
+    const char* name;
+    INTRINSIC routine;
+} ENTRY;
+
+static ENTRY registry[INTRINSICS];
+
+static void sort_range(void);
+static void hash_range(void);
+static void binary_search(void);
+static void format_decimal(void);
+static int compare_16(const void* a, const void* b);
+static int compare_32(const void* a, const void* b);
+
+
+/* intrinsic_register() - false if the number is out of range or taken */
+bool intrinsic_register(unsigned number, const char* name, INTRINSIC routine)
+{
+    if (INTRINSICS <= number || NULL != registry[number].routine || NULL == routine)
+        return false;
+    registry[number].name = name;
+    registry[number].routine = routine;
+    return true;
+}
+
+
+void intrinsic_init()
+{
+    intrinsic_register(SORT_RANGE, "sort-range", sort_range);
+    intrinsic_register(HASH_RANGE, "hash-range", hash_range);
+    intrinsic_register(BINARY_SEARCH, "binary-search", binary_search);
+    intrinsic_register(FORMAT_DECIMAL, "format-decimal", format_decimal);
+    if (NULL != intrinsic_extensions)
+        intrinsic_extensions();
+}
+
+
+void intrinsic_call(unsigned number)
+{
+    if (INTRINSICS <= number || NULL == registry[number].routine)
+        finish("Unknown intrinsic", FAIL);
+    registry[number].routine();
+}
+
+
+static void sort_range()
+{
+    uint32_t count = machine_pop();
+    void* words = machine_range(machine_pop(), count);
+
+    if (WIDE)
+        qsort(words, count, sizeof(uint32_t), compare_32);
+    else
+        qsort(words, count, sizeof(uint16_t), compare_16);
+}
+
+
+static void hash_range()
+{
+    uint32_t count = machine_pop();
+    void* words = machine_range(machine_pop(), count);
+    uint32_t hash = 2166136261u, i;
+
+    for (i = 0; i < count; i++)
+    {
+        hash ^= WIDE ? ((uint32_t*) words)[i] : ((uint16_t*) words)[i];
+        hash *= 16777619u;
+    }
+    machine_push(WIDE ? hash : (hash >> 16) ^ (hash & 0xFFFF));
+}
+
+
+static void binary_search()
+{
+    uint32_t key = machine_pop();
+    uint32_t count = machine_pop();
+    void* words = machine_range(machine_pop(), count);
+    uint32_t low = 0, high = count, middle, value;
+
+    while (low < high)
+    {
+        middle = low + (high - low) / 2;
+        value = WIDE ? ((uint32_t*) words)[middle] : ((uint16_t*) words)[middle];
+        if (value == key)
+        {
+            machine_push(middle);
+            return;
+        }
+        if (value < key)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    machine_push(UINT32_MAX);
+}
+
+
+static void format_decimal()
+{
+    uint32_t address = machine_pop();
+    uint32_t value = machine_pop();
+    char digits[16];
+    int length, i;
+
+    length = snprintf(digits, sizeof(digits), "%u", (unsigned) value);
+    machine_range(address, length);
+    for (i = 0; i < length; i++)
+        machine_store(address + i, digits[i]);
+    machine_push(length);
+}
+
+
+static int compare_16(const void* a, const void* b)
+{
+    return (int) *(const uint16_t*) a - (int) *(const uint16_t*) b;
+}
+
+
+static int compare_32(const void* a, const void* b)
+{
+    uint32_t x = *(const uint32_t*) a, y = *(const uint32_t*) b;
+
+    return (x > y) - (x < y);
+}
@@ -0,0 +1,44 @@
+/* intrinsic.h
+ * version 00.01.00
+ * Copyright (C) 2011  Joseph Osako
+ * This file is part of Pmac-Passim.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef INTRINSIC_H
+#define INTRINSIC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define INTRINSICS 256
+
+/* the built-in intrinsics */
+enum {SORT_RANGE = 0, HASH_RANGE, BINARY_SEARCH, FORMAT_DECIMAL};
+
+/* an intrinsic takes its arguments from the running machine's stack
+   and pushes its results there, by way of the machine_ functions in
+   pmac.h */
+typedef void (*INTRINSIC)(void);
+
+bool intrinsic_register(unsigned number, const char* name, INTRINSIC routine);
+void intrinsic_init(void);
+void intrinsic_call(unsigned number);
+
+/* defined by a program embedding pmac to register its own intrinsics */
+void intrinsic_extensions(void) __attribute__((weak));
+
+#endif
@@ -0,0 +1,167 @@
+/* io.c - the device backends behind the pmac I/O ports.
+ * The TTY port is the host's standard input and output, and the FDD
+ * port is the text disk image, one "%x\n" record per word, read and
+ * written through the block cache in cache.c. When the machine is one
+ * of a batch run by aio.c, the requests go through the asynchronous
+ * backend instead.
+ * version 00.01.00
+ * Copyright (C) 2011  Joseph Osako
+ * This file is part of Pmac-Passim.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <time.h>
+#include "pmac.h"
+#include "io.h"
+#include "aio.h"
+#include "cache.h"
+#include "stats.h"
+#include "smp.h"
+#include "fuzz.h"
+#include "shard.h"
+
+int tty_read()
+{
+    int ch;
+
+#ifdef PMAC_FUZZ
+    ch = fuzz_tty_read();
+#else
+    smp_lock();
+    ch = aio_active() ? aio_tty_read() : getchar();
+    smp_unlock();
+#endif
+    stats.tty_reads++;
+    if (EOF != ch)
+        stats.bytes_in++;
+    return ch;
+}
+
+
+void tty_write(int ch)
+{
+    stats.tty_writes++;
+    stats.bytes_out++;
+#ifndef PMAC_FUZZ     // the harness has no use for the output
+    smp_lock();
+    if (aio_active())
+        aio_tty_write(ch);
+    else
+        putchar(ch);
+    smp_unlock();
+#endif
+}
+
+
+/* tty_flush() - push out any TTY output still held in a buffer */
+void tty_flush()
+{
+    if (aio_active())
+        aio_tty_flush();
+    else
+        fflush(stdout);
+}
+
+
+uint32_t fdd_read(uint64_t seek)
+{
+    char record[16];
+    unsigned int value = 0;
+    long length;
+
+    stats.fdd_reads++;
+    stats.bytes_in += WIDE ? 4 : 2;
+
+#ifdef PMAC_FUZZ
+    return fuzz_disk_read(seek);
+#endif
+
+    if (shard_active())
+    {
+        if (seek >= shard_records)
+            return 0;       // as for a read past the end of the image
+        seek += shard_first;
+    }
+
+    if (aio_active())
+    {
+        length = aio_disk_read(record, DISK_RECORD, (off_t) seek * DISK_RECORD);
+        if (0 < length)
+        {
+            record[length] = '\0';
+            sscanf(record, DISK_SCAN, &value);
+        }
+    }
+    else
+    {
+        smp_lock();
+        value = cache_read(seek);
+        smp_unlock();
+    }
+    return value;
+}
+
+
+void fdd_write(uint64_t seek, uint32_t value)
+{
+    char record[16];
+
+    stats.fdd_writes++;
+    stats.bytes_out += WIDE ? 4 : 2;
+
+#ifdef PMAC_FUZZ
+    fuzz_disk_write(seek, value);
+    return;
+#endif
+
+    if (shard_active())
+    {
+        if (seek >= shard_records)
+            finish("Write outside the shard", FAIL);
+        seek += shard_first;
+    }
+
+    if (aio_active())
+    {
+        snprintf(record, sizeof(record), DISK_FORMAT, value);
+        aio_disk_write(record, DISK_RECORD, (off_t) seek * DISK_RECORD);
+    }
+    else
+    {
+        smp_lock();
+        cache_write(seek, value);
+        smp_unlock();
+    }
+}
+
+
+/* fdd_flush() - write back any disk words still held in the cache */
+void fdd_flush()
+{
+    if (!aio_active() && NULL != diskimg)
+        cache_flush();
+}
+
+
+/* clock_read() - the host's monotonic clock, in microseconds */
+uint64_t clock_read()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
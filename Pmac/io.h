@@ -0,0 +1,41 @@
+/* io.h
+ * version 00.01.00
+ * Copyright (C) 2011  Joseph Osako
+ * This file is part of Pmac-Passim.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef IO_H
+#define IO_H
+
+#include <stdint.h>
+
+/* a disk record is the word in hex, right aligned, and a newline; both
+   reads and writes find record n at n * DISK_RECORD */
+#define DISK_RECORD (WIDE ? 9 : 5)
+#define DISK_FORMAT (WIDE ? "%8x\n" : "%4x\n")
+#define DISK_SCAN   (WIDE ? "%8x" : "%4x")
+
+/* port backends used by input() and output() */
+int tty_read(void);
+void tty_write(int ch);
+void tty_flush(void);
+uint32_t fdd_read(uint64_t seek);
+void fdd_write(uint64_t seek, uint32_t value);
+void fdd_flush(void);
+uint64_t clock_read(void);
+
+#endif
@@ -24,709 +24,469 @@
 #include <string.h>
 #include <stdint.h>
 #include <stdbool.h>
-
-#define MAXMEM 65536
+#include <sys/mman.h>
+#include "pmac.h"
+#include "io.h"
+#include "aio.h"
+#include "stats.h"
+#include "tracefile.h"
+#include "smp.h"
+#include "channel.h"
+#include "intrinsic.h"
+#include "heap.h"
+#include "server.h"
+#include "coverage.h"
+#include "fuzz.h"
+#include "heatmap.h"
+#include "debug.h"
+#include "code.h"
+#include "fixed.h"
+#include "guard.h"
+#include "probes.h"
+#include "shard.h"
 
 int TRACE = false;  /* tracing toggle */
+_Thread_local bool WIDE = false;  /* 32-bit machine, selected by the image header */
 
-typedef enum {SUCCEED, FAIL} EXITTYPE;
 
-typedef uint16_t WORD;
+/* program and disk image files, of the machine on this thread */
+_Thread_local FILE* program = NULL;
+_Thread_local FILE* diskimg = NULL;
+_Thread_local bool finishing = false;
 
 
-/* program and disk image files */
-FILE* program = NULL;
-FILE* diskimg = NULL;
+char* jobfile = NULL;   /* batch of machines to run, for '-a' */
+char* pipeline = NULL;  /* stages joined by channels, for '-p' */
+char* server_socket = NULL;     /* socket to serve requests on, for '-f' */
+char* request_socket = NULL;    /* server to send a request to, for '-q' */
+char* request_disk = NULL;      /* and the disk image for the request */
+char* disk_path = NULL;     /* the disk image of a single run */
+char* trace_path = NULL;   /* binary trace file, for '-b' */
+char* coverage_path = NULL;    /* edge coverage map, for '-e' */
 
+#define USAGE "Usage: {<program> <diskimg> | -a <jobfile> | -p <pipeline> | -f <program> <socket> | -q <socket> <diskimg> | -n <shards> <program> <diskimg>} [-u <records>] [-r <op>] [-t] [-s <statsfile>] [-b <tracefile>] [-e <mapfile>] [-m <heatfile> [-g <words>] [-y <symbolmap>]] [-k <address>]... [-w <address>]... [-l <words>] [-c <cores>]"
 
-/* simulated memory and registers */
-WORD memory[MAXMEM];
 
-WORD ip = 0;           // instruction pointer
-WORD sp = MAXMEM - 1;  // stack pointer, initialized to the top of memory
-WORD fp = MAXMEM - 1;  // frame pointer, initially matches the stack pointer
+/* function prototypes */
+void parse_args(int count, char *list[]);
+void pause(void);
+void read_header(void);
+void* reserve_memory(size_t size);
 
 
-/* instruction set opcode values */
-enum {
-    HALT = 0,
-    PUSH, PUSHI, PUSHR, PUSHA, PUSHO, PUSHF, PUSHS, PUSHP, PUSHZ, DUP,
-    POPA = 0x0100, POPI, POPR, POPO, POPF,  POPS, DROP, SWAP,
-    BRA = 0x0200, BRI,
-    BRZ = 0x0300, BNZ,
-    BSR = 0x0400, RTS,
-    EQL = 0x0500, NEQ, LES, LEQ, GRE, GEQ,
-    ADD = 0x0600, INC = 0x06F0, SUB = 0x0700, DEC = 0x07F0,
-    MUL = 0x0800, DIV = 0x0900, MOD = 0x09F0,
-    SHL = 0x0A00, SHR = 0x0B00,
-    IOR = 0x0C00, XOR = 0x0D00, AND = 0x0E00, NOT = 0x0F00,
-    IN  = 0x1000, OUT = 0x2000
-} OPCODES;
+/* the machine itself, once for each word width */
+#define PER_WIDTH_CAT(name, width) name ## _ ## width
+#define PER_WIDTH_EXPAND(name, width) PER_WIDTH_CAT(name, width)
+#define PER_WIDTH_NAME(name) PER_WIDTH_EXPAND(name, PMAC_WIDTH)
 
-/* simulated I/O ports */
-enum {TTY = 0, FDD = 1} PORTS;
+#define PMAC_WIDTH 16
+#include "interp.h"
+#undef PMAC_WIDTH
 
-/* function prototypes */
-void finish(char* description, EXITTYPE result);
-void dumpregs(void);
-void pause(void);
-void read_program(void);
-void interp(void);
-void push(WORD val);
-WORD pop(void);
-WORD argument(void);
-WORD index_arg(void);
-void input(void);
-void output(void);
-void display_program(void);
+#define PMAC_WIDTH 32
+#include "interp.h"
+#undef PMAC_WIDTH
+
+/* call the version of a machine function matching the image width */
+#define PER_WIDTH(fn) (WIDE ? fn ## _32() : fn ## _16())
 
 
 /* main()
 The pmac program takes two arguments, a program file name
-and a disk image file name. An optional fourth argument, '-t',
-enables the tracing mode. The program indicates when
-the program begins and ends.
+and a disk image file name, followed by any options (see
+parse_args()). The program indicates when the program
+begins and ends.
+Alternately, '-a' followed by a job file runs a batch of
+machines together with asynchronous I/O (see aio.c), and
+'-p' followed by a pipeline file runs machines joined by
+channels, each on its own thread (see channel.c).
+With '-c', the program runs on several cores (see smp.c).
+'-f' loads a program and serves requests to run it on a
+socket, and '-q' sends such a request (see server.c).
+'-n' runs the program over shards of its disk image, each
+in a process of its own (see shard.c).
+Built with PMAC_FUZZ, there is no main(); the fuzzing
+harness in fuzz.c drives the machine instead.
+Under afl-fuzz, or with '-e', the branches the program takes
+are counted in an edge coverage map (see coverage.c).
 */
+#ifndef PMAC_FUZZ
 int main (int argc, char *argv[])
 {
-    if (3 > argc)
-        finish("Usage: <program> <diskimg>", FAIL);
+    parse_args(argc, argv);
+    intrinsic_init();
 
-    /* open the two working files */
+    if (NULL != jobfile)
+        aio_run(jobfile);
+    if (NULL != pipeline)
+        channel_run(pipeline);
+    if (NULL != request_socket)
+        server_request(request_socket, request_disk);
 
-    if (NULL == (program = fopen(argv[1], "r")))
-        finish("Program file not found", FAIL);
-
-    if (NULL == (diskimg = fopen(argv[2], "rw+")))
+    printf("\nLoading Program...");
+    load_program();
+    printf("done.");
+    if (NULL != trace_path)
+        tracefile_open(trace_path);
+    if (NULL == server_socket)
+        coverage_open(coverage_path);
+    if (NULL != heat_path)
+        heat_open();
+    if (TRACE)
     {
-        finish("Could not create disk image file", FAIL);
+        PER_WIDTH(display_program);
     }
+    if (debug_active())
+        debug_arm();
+    if (NULL != server_socket)
+        server_run(server_socket);
+    if (NULL != coverage_map)
+        coverage_forkserver(disk_path);
+    puts("Beginning run:");
+    if (0 < shard_count)
+        shard_run();
+    else if (1 < smp_cores)
+        smp_run();
+    else
+        run_machine();
+    return 0;
+}
+#endif
+
+/* parse_args() - open the working files and read the options:
+     -t             tracing mode
+     -s <file>      write the performance counters to <file> as JSON
+     -b <file>      record a binary execution trace in <file>
+     -e <file>      count the edges the program takes in the map <file>
+     -m <file>      write a heatmap of the memory accesses to <file>
+     -g <words>     count the heatmap in buckets of that many words
+     -y <file>      name the hottest ranges with the labels in <file>
+     -k <address>   stop at a breakpoint before the instruction at <address>
+     -w <address>   report stores to the word at <address>
+     -l <words>     fault a stack growing past <words> with guard pages
+     -u <records>   start each shard on a multiple of that many records
+     -r <op>        reduce the tops of the shards' stacks with <op>
+     -c <cores>     run the program on that many cores sharing its memory
+*/
+void parse_args(int count, char *list[])
+{
+    int i, options = 3;
+    bool single;
+
+    if (3 > count)
+        finish(USAGE, FAIL);
 
-    if (4 == argc && 0 == strcmp(argv[3], "-t"))
+    if (0 == strcmp(list[1], "-a"))
+        jobfile = list[2];
+    else if (0 == strcmp(list[1], "-p"))
+        pipeline = list[2];
+    else if (0 == strcmp(list[1], "-f") && 4 <= count)
+    {
+        if (NULL == (program = fopen(list[2], "r")))
+            finish("Program file not found", FAIL);
+        server_socket = list[3];
+        options = 4;
+    }
+    else if (0 == strcmp(list[1], "-n") && 5 <= count)
     {
-        TRACE = true;
-        puts("tracing mode ON");
+        shard_count = atoi(list[2]);
+        if (2 > shard_count || MAX_SHARDS < shard_count)
+            finish("The number of shards must be from 2 to 256", FAIL);
+        if (NULL == (program = fopen(list[3], "r")))
+            finish("Program file not found", FAIL);
+        if (NULL == (diskimg = fopen(list[4], "rw+")))
+            finish("Could not create disk image file", FAIL);
+        shard_disk = list[4];
+        options = 5;
+    }
+    else if (0 == strcmp(list[1], "-q") && 4 <= count)
+    {
+        request_socket = list[2];
+        request_disk = list[3];
+        options = 4;
     }
     else
-        TRACE = false;
+    {
+        /* open the two working files */
 
-    printf("\nLoading Program...");
-    memset(memory, 0, MAXMEM); // clear the memory
-    read_program();
-    printf("done.");
-    if (TRACE)
+        if (NULL == (program = fopen(list[1], "r")))
+            finish("Program file not found", FAIL);
+
+        disk_path = list[2];
+        if (NULL == (diskimg = fopen(list[2], "rw+")))
+        {
+            finish("Could not create disk image file", FAIL);
+        }
+    }
+
+    /* tracing and the cores follow a single machine run from here */
+    single = (NULL == jobfile && NULL == pipeline && NULL == request_socket && 0 == shard_count);
+
+    TRACE = false;
+    for (i = options; i < count; i++)
     {
-        display_program();
+        if (0 == strcmp(list[i], "-t") && single && NULL == server_socket)
+        {
+            TRACE = true;
+            puts("tracing mode ON");
+        }
+        else if (0 == strcmp(list[i], "-s") && (i + 1) < count)
+        {
+            stats_path = list[++i];
+        }
+        else if (0 == strcmp(list[i], "-b") && (i + 1) < count && single && NULL == server_socket)
+        {
+            trace_path = list[++i];
+        }
+        else if (0 == strcmp(list[i], "-e") && (i + 1) < count && single && NULL == server_socket)
+        {
+            coverage_path = list[++i];
+        }
+        else if (0 == strcmp(list[i], "-m") && (i + 1) < count && single && NULL == server_socket)
+        {
+            heat_path = list[++i];
+        }
+        else if (0 == strcmp(list[i], "-g") && (i + 1) < count && single)
+        {
+            heat_bucket = strtoul(list[++i], NULL, 0);
+            if (0 == heat_bucket)
+                finish(USAGE, FAIL);
+        }
+        else if (0 == strcmp(list[i], "-y") && (i + 1) < count && single)
+        {
+            symbol_path = list[++i];
+        }
+        else if (0 == strcmp(list[i], "-k") && (i + 1) < count && single && NULL == server_socket)
+        {
+            debug_break_at(strtoul(list[++i], NULL, 16));
+        }
+        else if (0 == strcmp(list[i], "-w") && (i + 1) < count && single && NULL == server_socket)
+        {
+            debug_watch(strtoul(list[++i], NULL, 16));
+        }
+        else if (0 == strcmp(list[i], "-u") && (i + 1) < count && 0 < shard_count)
+        {
+            shard_unit = strtoul(list[++i], NULL, 0);
+            if (0 == shard_unit)
+                finish(USAGE, FAIL);
+        }
+        else if (0 == strcmp(list[i], "-r") && (i + 1) < count && 0 < shard_count)
+        {
+            shard_reduce_by(list[++i]);
+        }
+        else if (0 == strcmp(list[i], "-l") && (i + 1) < count)
+        {
+            guard_limit = strtoul(list[++i], NULL, 0);
+            if (0 == guard_limit)
+                finish(USAGE, FAIL);
+        }
+        else if (0 == strcmp(list[i], "-c") && (i + 1) < count && single)
+        {
+            smp_cores = atoi(list[++i]);
+            if (1 > smp_cores || MAX_CORES < smp_cores)
+                finish("The number of cores must be from 1 to 16", FAIL);
+        }
+        else
+        {
+            finish(USAGE, FAIL);
+        }
     }
-    puts("Beginning run:");
-    interp();
-    return 0;
+    /* tracing, interactive or not, follows a single machine, and the guard pages a single stack */
+    if (1 < smp_cores && (TRACE || NULL != trace_path || NULL != coverage_path || NULL != heat_path
+                          || debug_active() || guard_active()))
+        finish(USAGE, FAIL);
+    stats_init();
 }
 
 void finish(char* description, EXITTYPE result)
 {
+    if (FAIL == result)
+        PROBE2(fault, description, WIDE ? ip_32 : ip_16);
+#ifdef PMAC_FUZZ
+    fuzz_exit(description, result);     // back to the harness for the next input
+#endif
+    if (aio_active())
+        tty_flush();
+    smp_lock();     // one core reports at a time
+    finishing = true;   // a guard page fault from the report is not another end
     puts("\n");
     puts(description);
     puts("\n");
     dumpregs();
+    if (shard_active())
+        shard_report(result);   // the top of its stack, for the reduction
+    finishing = false;
+    if (FAIL == result)
+        coverage_crash();   // as a signal, for the fuzzer to see
+    if (aio_active())
+        aio_exit(result);   // ends only the running job
+    if (smp_active())
+        smp_exit(result);   // a halted core leaves the others running
+    if (channel_active())
+        channel_exit(result);   // as does a halted stage of a pipeline
+    fdd_flush();
+    stats_write();
+    heat_write();
+    tracefile_close();
     if (program != NULL) fclose(program);
     if (diskimg != NULL) fclose(diskimg);
     exit(result);
 }
 
 
-// dumpregs() - display the registers as a line of text
+// dumpregs() - display the registers of whichever machine is running
 void dumpregs()
 {
-    printf("Registers: IP:%4x   SP:%4x   FP:%4x   TOS:%4x\n\n", ip, sp, fp, memory[sp]);
+    if ((WIDE ? (void *) memory_32 : (void *) memory_16) != NULL)
+        PER_WIDTH(dumpregs);
 }
 
-void read_program()
-{
-    int i;
-
-    for (i = 0; !feof(program) && !ferror(program) && i < MAXMEM; i++)
-        fscanf(program, "%4x", (unsigned int *) &memory[i]);
-}
 
-void trace(char *inst, WORD op)
+/* load_program() - set up a fresh machine for the image in 'program'.
+*/
+void load_program()
 {
-    if (TRACE)
-    {
-        printf("Inst: %s  Opcode: %4x\n", inst, op);
-        dumpregs();
-        getchar();
-    }
-
+    WIDE = false;
+    code_declared = false;
+    read_header();
+    PER_WIDTH(init_machine);
+    code_map();
+    PER_WIDTH(read_program);
+    code_share();
 }
 
-void interp()
-{
-    WORD op;
-    WORD temp;
 
-    do
-    {
-        op = memory[ip];
+/* run_machine() - start the loaded machine; it only returns by way of finish().
+*/
+void run_machine()
+{
+    PROBE1(start, WIDE ? 32 : 16);
+    PER_WIDTH(interp);
+}
 
-        switch(op)
-        {
-            case HALT:
-                trace("HALT", op);
-                finish("Execution halted.", SUCCEED);
-                break;
-            case PUSH:      /* push immediate */
-                temp = argument();
-                push(temp);
-                if (TRACE)
-                {
-                    printf("Inst: PUSH #%4x  Opcode: %4x\n",
-                           temp, op);
-                    dumpregs();
-                    getchar();
-                }
-                break;
-            case PUSHI:     /* push indexed */
-                temp = index_arg();
-                push(memory[temp]);
-                if(TRACE)
-                {
-                    printf("Inst: PUSH %4x[%4x]  Opcode: %4x Index: %4x\n I",
-                           memory[ip-1], memory[ip], op, memory[memory[ip]]);
-                    dumpregs();
-                    getchar();
-                }
-                break;
-            case PUSHR:     /* push indirect from stack */
-                temp = pop();
-                push(memory[temp]);
-                trace("PUSHR", op);
-                break;
-            case PUSHA:     /* push indirect from argument */
-                temp = argument();
-                push(memory[temp]);
-                if(TRACE)
-                {
-                    printf("Inst: PUSHA %4x  Opcode: %4x\n", temp, op);
-                    dumpregs();
-                    getchar();
-                }
-                break;
-             case PUSHO:     /* push from frame pointer offset */
-                temp = pop();
-                push(memory[fp + temp]);
-                trace("PUSHO", op);
-            case PUSHF:     /* push frame pointer */
-                push(fp);
-                trace("PUSHF", op);
-                break;
-            case PUSHS:     /* push stack pointer */
-                push(sp);
-                trace("PUSHS", op);
-                break;
-            case PUSHP:     /* push instruction pointer */
-                push(ip);
-                trace("PUSHP", op);
-                break;
-            case PUSHZ:     /* push zero */
-                push(0);
-                trace("PUSHZ", op);
-                break;
-            case DUP:     /* push zero */
-                push(memory[sp]);
-                trace("DUP", op);
-                break;
-            case POPA:
-                memory[argument()] = pop();
-                if(TRACE)
-                {   temp = memory[ip];
-                    printf("Inst: POP %4x Opcode: %4x Target: %4x\n",
-                            temp, op, memory[temp]);
-                    dumpregs();
-                    getchar();
-                }
-                break;
-            case POPI:
-                memory[index_arg()] = pop();
-                if(TRACE)
-                {
-                    temp = memory[ip] + memory[ip + 1];
-                    printf("Inst: POP %4x[%4x]  Opcode: %4x Target: %4x\n",
-                            memory[ip], memory[ip-1], op, temp);
-                    dumpregs();
-                    getchar();
-                }
-                break;
-            case POPO:
-                temp = pop();
-                memory[fp + temp] = pop();
-                trace("POPO", op);
-                break;
-            case POPR:
-                temp = pop();
-                memory[temp] = pop();
-                trace("POPR", op);
-                break;
-            case POPF:
-                fp = pop();
-                trace("POPF", op);
-                break;
-            case POPS:
-                sp = pop();
-                trace("POPS", op);
-                break;
-            case DROP:
-                pop();            /*ignore result */
-                trace("DROP", op);
-                break;
-            case SWAP:
-                temp = memory[sp];
-                memory[sp] = memory[sp-1];
-                memory[sp-1] = temp;
-                trace("SWAP", op);
-                break;
-
-            /* branch */
-            case BRA:
-                ip = argument();
-                if(TRACE)
-                {
-                    printf("Inst: BRA %4x Opcode: %4x\n", memory[ip], op);
-                    dumpregs();
-                    getchar();
-                }
-                break;
-            case BRI:
-                ip = index_arg();
-                if(TRACE)
-                {
-                    printf("Inst: BRI %4x[%4x]  Opcode: %4x\n", memory[ip], memory[ip-1], op);
-                    dumpregs();
-                    getchar();
-                }
-                break;
-            /* conditional branch */
-            case BRZ:
-                temp = pop();
-                if (0 == temp)
-                    ip = argument();
-                else
-                   ip += 2;
-                if(TRACE)
-                {
-                    printf("Inst: BRZ %4x Opcode: %4x\n", memory[ip], op);
-                    dumpregs();
-                    getchar();
-                }
-                break;
-            case BNZ:
-                temp = pop();
-                if (0 != temp)
-                    ip = argument();
-                else
-                   ip += 2;
-                if(TRACE)
-                {
-                    printf("Inst: BNZ %4x Opcode: %4x\n", memory[ip], op);
-                    dumpregs();
-                    getchar();
-                }
-                break;
-            /* call and return */
-            case BSR:
-                push(ip);
-                ip = argument();
-                if(TRACE)
-                {
-                    printf("Inst: BSR %4x Opcode: %4x\n", memory[ip], op);
-                    dumpregs();
-                    getchar();
-                }
-                break;
-            case RTS:
-                ip = pop();
-                trace("RTS", op);
-                break;
-            /* comparisons */
-                break;
-            case EQL:
-                temp = pop();
-                push(pop() == temp ? 1 : 0);
-                trace("EQL", op);
-                break;
-            case NEQ:
-                temp = pop();
-                push(pop() == temp ? 0 : 1);
-                trace("NEQ", op);
-                break;
-            case LES:
-                temp = pop();
-                push(temp < pop() ? 0 : 1);
-                trace("NEQ", op);
-                break;
-            case LEQ:
-                temp = pop();
-                push(temp <= pop() ? 0 : 1);
-                trace("LEQ", op);
-                break;
-            case GRE:
-                temp = pop();
-                push(temp > pop() ? 0 : 1);
-                trace("GRE", op);
-                break;
-            case GEQ:
-                temp = pop();
-                push(temp >= pop() ? 0 : 1);
-                trace("GEQ", op);
-                break;
-            case ADD:
-                push(pop() + pop());
-                trace("ADD", op);
-                break;
-            case INC:
-                (memory[sp])++;
-                trace("INC", op);
-                break;
-            case SUB:
-                push(pop() - pop());
-                trace("SUB", op);
-                break;
-            case DEC:
-                (memory[sp])--;
-                trace("DEC", op);
-                break;
-            case MUL:
-                push(pop() * pop());
-                trace("MUL", op);
-                break;
-            case DIV:
-                temp = pop();
-                if (0 == temp)
-                    finish("Divide by Zero Error", FAIL);
-                else
-                    push(pop() / temp);
-                trace("DIV", op);
-                break;
-            case MOD:
-                temp = pop();
-                push(pop() % temp);
-                trace("MOD", op);
-                break;
-             /* shift operators */
-            case SHL:
-                memory[sp] <<= pop();
-                trace("SHL", op);
-                break;
-            case SHR:
-                memory[sp] >>= pop();
-                trace("SHR", op);
-                break;
-            case IOR:
-                memory[sp] |= pop();
-                trace("IOR", op);
-                break;
-            case XOR:
-                memory[sp] ^= pop();
-                trace("XOR", op);
-                break;
-            case AND:
-                memory[sp] &= pop();
-                trace("AND", op);
-                break;
-            case NOT:
-                memory[sp] = ~memory[sp];
-                trace("NOT", op);
-                break;
-            case IN:
-                input();
-                break;
-            case OUT:
-                output();
-                break;
-            default:
-                break;    /* do nothing */
-        }
-        if (op != BRA && op != BRZ && op != BNZ && op != BSR && op != RTS && op != HALT)
-        {
-            ip++;
-        }
-    } while (1);
 
+/* machine_pop() and the rest - the stack, memory and heap register of
+   the running machine, for the intrinsics and the heap (see intrinsic.c
+   and heap.c)
+*/
+uint32_t machine_pop()
+{
+    heat_count(WIDE ? sp_32 : sp_16, HEAT_STACK_READ);
+    return WIDE ? pop_32() : pop_16();
 }
 
-void push(WORD value)
+uint32_t machine_top()
 {
-    memory[--sp] = value;
+    return PER_WIDTH(stack_word);
 }
 
-WORD pop()
+void machine_push(uint32_t value)
 {
-    return memory[sp++];
+    heat_count(WIDE ? sp_32 - 1 : (uint16_t) (sp_16 - 1), HEAT_STACK_WRITE);
+    if (WIDE)
+        push_32(value);
+    else
+        push_16(value);
 }
 
-WORD argument()
+uint32_t machine_load(uint32_t address)
 {
-    ip++;
-    return memory[ip];
+    heat_count(WIDE ? address : (uint16_t) address, HEAT_DATA_READ);
+    return WIDE ? memory_32[address] : memory_16[(uint16_t) address];
 }
 
-WORD index_arg()
+void machine_store(uint32_t address, uint32_t value)
 {
-    WORD base, index;
-
-    base = argument();
-    index = argument();
-    return (base + memory[index]);
+    heat_count(WIDE ? address : (uint16_t) address, HEAT_DATA_WRITE);
+    if (WIDE)
+        memory_32[address] = value;
+    else
+        memory_16[(uint16_t) address] = value;
+    FUZZ_DIRTY(WIDE ? address : (uint16_t) address);
 }
 
+void* machine_range(uint32_t address, uint32_t count)
+{
+    return WIDE ? memory_range_32(address, count) : memory_range_16(address, count);
+}
 
-void output()
+uint32_t machine_heap()
 {
-    WORD port, seek, value;
+    return WIDE ? heap_base_32 : heap_base_16;
+}
 
-    port = seek = value = 0;
+void machine_set_heap(uint32_t base)
+{
+    if (WIDE)
+        heap_base_32 = base;
+    else
+        heap_base_16 = base;
+}
 
-    port = pop();
 
-    switch(port)
-    {
-        case TTY:
-            value = pop();
-            putchar((char) value);
-            break;
-        case FDD:
-            seek = pop();
-            seek *= sizeof(WORD) + strlen("\n") + 2;
-            value = pop();
-            fseek(diskimg, seek, 0);
-            fprintf(diskimg, "%4x\n", value);
-            break;
-        default:
-            if (TRACE)
-            {
-                printf("Inst: OUT  Opcode: %4x  Port: %4x  Seek: %4x  Value: %4x\n",
-                       OUT, port, seek * sizeof(WORD), value);
-                       dumpregs();
-                       getchar();
-            }
-            finish("Invalid output port", FAIL);
-            break;
-    }
-    if (TRACE)
-    {
-        printf("Inst: OUT  Opcode: %4x  Port: %4x  Seek: %4x  Value: %4x\n",
-               OUT, port, seek, value);
-        dumpregs();
-        getchar();
-    }
+/* save_machine(), load_machine() - switch between machines by copying
+   their registers out of and back into the interpreter's globals.
+*/
+void save_machine(MACHINE* m)
+{
+    m->wide = WIDE;
+    if (WIDE)
+        save_machine_32(m);
+    else
+        save_machine_16(m);
+}
 
+void load_machine(const MACHINE* m)
+{
+    WIDE = m->wide;
+    if (WIDE)
+        load_machine_32(m);
+    else
+        load_machine_16(m);
 }
 
-void input()
+
+/* read_header() - read the directives at the start of the image, one
+   to a line. An image produced by 'passim -w' starts with a '.WIDE'
+   line, which selects the 32-bit machine; images without a header are
+   16-bit. '.CODE <first> <last>' declares the words from <first> to
+   <last> as code to be shared between machines (see code.c); 'passim
+   -c <label>' writes it.
+*/
+void read_header()
 {
-    WORD port, seek = 0, value = 0;
+    char directive[16];
+    int ch = EOF;
 
-    port = pop();
-    switch (port)
+    while (EOF != fscanf(program, " ") && '.' == (ch = fgetc(program)))
     {
-        case TTY:
-            push(getchar());
-            break;
-        case FDD:
-            seek = pop();
-            seek *= sizeof(WORD);
-            fseek(diskimg, seek, 0);
-            fscanf(diskimg, "%4x", (unsigned int *) &value);
-            push(value);
-            break;
-        default:
-            if (TRACE)
-            {
-                printf("Inst: OUT  Opcode: %4x  Port: %4x  Seek: %4x  Value: %4x\n",
-                       OUT, port, seek, value);
-                dumpregs();
-                getchar();
-            }
-            finish("Invalid input port", FAIL);
-            break;
+        if (1 != fscanf(program, "%15s", directive))
+            finish("Invalid image header", FAIL);
+
+        if (0 == strcmp(directive, "WIDE"))
+            WIDE = true;
+        else if (0 == strcmp(directive, "CODE")
+                 && 2 == fscanf(program, "%x %x", &code_first, &code_last))
+            code_declared = true;
+        else
+            finish("Unknown image directive", FAIL);
     }
-    if (TRACE)
-    {
-        printf("Inst: OUT  Opcode: %4x  Port: %4x  Seek: %4x  Value: %4x\n",
-               OUT, port, seek, value);
-        dumpregs();
-        getchar();
-    }
-
+    ungetc(ch, program);
 }
 
-void display_program()
-{
-    WORD op;
-   /* WORD temp; */
 
-    puts("\nProgram Listing:");
-    do
-    {
-        op = memory[ip];
+/* reserve_memory() - map an address range for the simulated memory.
+   The range is only reserved, not committed; the host supplies zeroed
+   pages on first touch, which is what makes the 16 GB memory of a wide
+   machine affordable.
+*/
+void* reserve_memory(size_t size)
+{
+    void* region;
 
-        switch(op)
-        {
-            case HALT:
-                puts("HALT");
-                break;
-            case PUSH:      /* push immediate */
-                ip++;
-                printf("PUSH #%4x\n", memory[ip]);
-                break;
-            case PUSHI:     /* push indexed */
-                ip += 2;
-                printf("PUSH %4x[%4x]\n", memory[ip - 1], memory[ip]);
-                break;
-            case PUSHA:     /* push indirect */
-                ip++;
-                printf("PUSH %4x\n", memory[ip]);
-                break;
-            case PUSHR:     /* push indirect from stack */
-                puts("PUSHR");
-                break;
-            case PUSHF:     /* push frame pointer */
-                puts("PUSHF");
-                break;
-            case PUSHS:     /* push stack pointer */
-                puts("PUSHS");
-                break;
-            case PUSHP:     /* push instruction pointer */
-                puts("PUSHP");
-                break;
-            case PUSHZ:     /* push zero */
-                puts("PUSHZ");
-                break;
-            case DUP:     /* push zero */
-                puts("DUP");
-                break;
-            case POPA:
-                ip++;
-                printf("POP %4x\n", memory[ip]);
-                break;
-            case POPI:
-                ip += 2;
-                printf("POP %4x[%4x]\n", memory[ip - 1], memory[ip]);
-                break;
-            case POPR:
-                puts("POPR");
-                break;
-            case POPF:
-                puts("POPF");
-                break;
-            case POPS:
-                puts("POPS");
-                break;
-            case DROP:
-                puts("DROP");
-                break;
-            case SWAP:
-                puts("SWAP");
-                break;
-            /* branch */
-            case BRA:
-                ip++;
-                printf("BRA %4x\n", memory[ip]);
-                break;
-            case BRI:
-                ip += 2;
-                printf("BRI %4x[%4x]\n", memory[ip - 1], memory[ip]);
-                break;
-            /* conditional branch */
-            case BRZ:
-                ip++;
-                printf("BRZ %4x\n", memory[ip]);
-                break;
-            case BNZ:
-                ip++;
-                printf("BNZ %4x\n", memory[ip]);
-                break;
-            /* call and return */
-            case BSR:
-                ip++;
-                printf("BSR %4x\n", memory[ip]);
-                break;
-            case RTS:
-                puts("RTS");
-                break;
-            /* comparisons */
-                break;
-            case EQL:
-                puts("EQL");
-                break;
-            case NEQ:
-                puts("NEQ");
-                break;
-            case LES:
-                puts("NEQ");
-                break;
-            case LEQ:
-                puts("LEQ");
-                break;
-            case GRE:
-                puts("GRE");
-                break;
-            case GEQ:
-                puts("GEQ");
-                break;
-            case ADD:
-                puts("ADD");
-                break;
-            case INC:
-                puts("INC");
-                break;
-            case SUB:
-                puts("SUB");
-                break;
-            case DEC:
-                puts("DEC");
-                break;
-            case MUL:
-                puts("MUL");
-                break;
-            case DIV:
-                puts("DIV");
-                break;
-            case MOD:
-                puts("MOD");
-                break;
-             /* shift operators */
-            case SHL:
-                puts("SHL");
-                break;
-            case SHR:
-                puts("SHR");
-                break;
-            case IOR:
-                puts("IOR");
-                break;
-            case XOR:
-                puts("XOR");
-                break;
-            case AND:
-                puts("AND");
-                break;
-            case NOT:
-                puts("NOT");
-                break;
-            case IN:
-                puts("IN");
-                break;
-            case OUT:
-                puts("OUT");
-                break;
-            default:
-                break;    /* do nothing */
-        }
-        ip++;
-    } while (HALT != op);
-    /* reset values to start point */
-    ip = 0;
-    sp = fp = MAXMEM - 1;
-    puts("\n");
+    region = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (MAP_FAILED == region)
+        finish("Could not reserve machine memory", FAIL);
+    return region;
 }
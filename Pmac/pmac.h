@@ -0,0 +1,91 @@
+/* pmac.h
+ * version 00.01.00
+ * Copyright (C) 2011  Joseph Osako
+ * This file is part of Pmac-Passim.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef PMAC_H
+#define PMAC_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum {SUCCEED, FAIL} EXITTYPE;
+
+/* instruction set opcode values */
+typedef enum {
+    HALT = 0,
+    PUSH, PUSHI, PUSHR, PUSHA, PUSHO, PUSHF, PUSHS, PUSHP, PUSHZ, DUP, LOADL,
+    POPA = 0x0100, POPI, POPR, POPO, POPF,  POPS, DROP, SWAP, STOREL,
+    BRA = 0x0200, BRI,
+    BRZ = 0x0300, BNZ, BEQ, BNE, BLT, BGE, BEQA, BNEA, BLTA, BGEA, DBNZ,
+    BSR = 0x0400, RTS, ENTER, LEAVE,
+    EQL = 0x0500, NEQ, LES, LEQ, GRE, GEQ,
+    ADD = 0x0600, INC = 0x06F0, SUB = 0x0700, DEC = 0x07F0,
+    MUL = 0x0800, DIV = 0x0900, MOD = 0x09F0,
+    SHL = 0x0A00, ROL, SHR = 0x0B00, ROR,
+    IOR = 0x0C00, XOR = 0x0D00, AND = 0x0E00, NOT = 0x0F00, POPCNT, CLZ, CTZ, BSWAP,
+    IN  = 0x1000, OUT = 0x2000,
+    DADD = 0x3000, DSUB, DMUL, DCMP, DSHL, DSHR,
+    QMUL = 0x3100, QDIV, QSQRT, QADD, QSUB,
+    CAS = 0x4000, AADD, CPUID, NCPU, BARRIER,
+    CALLN = 0x5000,
+    HEAP = 0x6000, ALLOC, FREE, RESIZE,
+    BRK = 0xFF00                    // reserved for breakpoints (see debug.c)
+} OPCODES;
+
+/* simulated I/O ports */
+typedef enum {TTY = 0, FDD = 1, FDDX = 2, RETIRED = 3, CLOCK = 4,
+              CHANNEL_PORT = 0x10, BLOCK_PORT = 0x20} PORTS;
+
+/* register state of one machine, for switching between machines */
+typedef struct
+{
+    bool wide;
+    void* core;                     // the machine's memory
+    uint32_t ip_reg, sp_reg, fp_reg;
+    uint32_t top_reg;               // the top of its stack
+    uint32_t heap_reg;              // the base of its heap, 0 for none
+} MACHINE;
+
+/* globals */
+extern int TRACE;       // tracing toggle
+extern _Thread_local bool WIDE;   // 32-bit machine, selected by the image header
+extern _Thread_local FILE* program;
+extern _Thread_local FILE* diskimg;
+extern _Thread_local bool finishing;    // finish() is reporting the machine's end
+
+/* function prototypes */
+void finish(char* description, EXITTYPE result);
+void dumpregs(void);
+void load_program(void);
+void run_machine(void);
+void save_machine(MACHINE* m);
+void load_machine(const MACHINE* m);
+
+/* the running machine, whatever its width */
+uint32_t machine_pop(void);
+uint32_t machine_top(void);
+void machine_push(uint32_t value);
+uint32_t machine_load(uint32_t address);
+void machine_store(uint32_t address, uint32_t value);
+void* machine_range(uint32_t address, uint32_t count);
+uint32_t machine_heap(void);
+void machine_set_heap(uint32_t base);
+
+#endif
@@ -0,0 +1,218 @@
+/* pmtrace.c - decoder for the binary execution traces recorded by pmac -b.
+ * Prints each traced instruction as a program listing line, followed
+ * by the registers as they stood when it started. Given the program
+ * image, the listing includes the instruction arguments.
+ * version 00.01.00
+ * Copyright (C) 2011  Joseph Osako
+ * This file is part of Pmac-Passim.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "pmac.h"
+#include "tracefile.h"
+
+typedef enum {NO_ARG, IMMEDIATE, ADDRESS, INDEXED, IMMEDIATE_BRANCH, ADDRESS_BRANCH} ARGKIND;
+
+typedef struct
+{
+    uint32_t op;
+    char* name;
+    ARGKIND args;
+} OPINFO;
+
+/* the instruction set, as display_program() lists it */
+static const OPINFO optable[] = {
+    {HALT, "HALT", NO_ARG},     {PUSH, "PUSH", IMMEDIATE},
+    {PUSHI, "PUSH", INDEXED},   {PUSHR, "PUSHR", NO_ARG},
+    {PUSHA, "PUSH", ADDRESS},   {PUSHO, "PUSHO", NO_ARG},
+    {PUSHF, "PUSHF", NO_ARG},   {PUSHS, "PUSHS", NO_ARG},
+    {PUSHP, "PUSHP", NO_ARG},   {PUSHZ, "PUSHZ", NO_ARG},
+    {DUP, "DUP", NO_ARG},       {POPA, "POP", ADDRESS},
+    {POPI, "POP", INDEXED},     {POPR, "POPR", NO_ARG},
+    {POPO, "POPO", NO_ARG},     {POPF, "POPF", NO_ARG},
+    {POPS, "POPS", NO_ARG},     {DROP, "DROP", NO_ARG},
+    {SWAP, "SWAP", NO_ARG},     {BRA, "BRA", ADDRESS},
+    {BRI, "BRI", INDEXED},      {BRZ, "BRZ", ADDRESS},
+    {BNZ, "BNZ", ADDRESS},      {BSR, "BSR", ADDRESS},
+    {RTS, "RTS", NO_ARG},       {EQL, "EQL", NO_ARG},
+    {NEQ, "NEQ", NO_ARG},       {LES, "LES", NO_ARG},
+    {LEQ, "LEQ", NO_ARG},       {GRE, "GRE", NO_ARG},
+    {GEQ, "GEQ", NO_ARG},       {ADD, "ADD", NO_ARG},
+    {INC, "INC", NO_ARG},       {SUB, "SUB", NO_ARG},
+    {DEC, "DEC", NO_ARG},       {MUL, "MUL", NO_ARG},
+    {DIV, "DIV", NO_ARG},       {MOD, "MOD", NO_ARG},
+    {SHL, "SHL", NO_ARG},       {SHR, "SHR", NO_ARG},
+    {IOR, "IOR", NO_ARG},       {XOR, "XOR", NO_ARG},
+    {AND, "AND", NO_ARG},       {NOT, "NOT", NO_ARG},
+    {ROL, "ROL", NO_ARG},       {ROR, "ROR", NO_ARG},
+    {POPCNT, "POPCNT", NO_ARG}, {CLZ, "CLZ", NO_ARG},
+    {CTZ, "CTZ", NO_ARG},       {BSWAP, "BSWAP", NO_ARG},
+    {IN, "IN", NO_ARG},         {OUT, "OUT", NO_ARG},
+    {DADD, "DADD", NO_ARG},     {DSUB, "DSUB", NO_ARG},
+    {DMUL, "DMUL", NO_ARG},     {DCMP, "DCMP", NO_ARG},
+    {DSHL, "DSHL", NO_ARG},     {DSHR, "DSHR", NO_ARG},
+    {CAS, "CAS", NO_ARG},       {AADD, "AADD", NO_ARG},
+    {CPUID, "CPUID", NO_ARG},   {NCPU, "NCPU", NO_ARG},
+    {BARRIER, "BARRIER", NO_ARG}, {CALLN, "CALLN", IMMEDIATE},
+    {HEAP, "HEAP", NO_ARG},     {ALLOC, "ALLOC", NO_ARG},
+    {FREE, "FREE", NO_ARG},     {RESIZE, "RESIZE", NO_ARG},
+    {LOADL, "LOADL", IMMEDIATE}, {STOREL, "STOREL", IMMEDIATE},
+    {ENTER, "ENTER", IMMEDIATE}, {LEAVE, "LEAVE", NO_ARG},
+    {BEQ, "BEQ", IMMEDIATE_BRANCH}, {BNE, "BNE", IMMEDIATE_BRANCH},
+    {BLT, "BLT", IMMEDIATE_BRANCH}, {BGE, "BGE", IMMEDIATE_BRANCH},
+    {BEQA, "BEQA", ADDRESS_BRANCH}, {BNEA, "BNEA", ADDRESS_BRANCH},
+    {BLTA, "BLTA", ADDRESS_BRANCH}, {BGEA, "BGEA", ADDRESS_BRANCH},
+    {DBNZ, "DBNZ", ADDRESS_BRANCH}, {QMUL, "QMUL", NO_ARG},
+    {QDIV, "QDIV", NO_ARG},     {QSQRT, "QSQRT", NO_ARG},
+    {QADD, "QADD", NO_ARG},     {QSUB, "QSUB", NO_ARG},
+    {BRK, "BRK", NO_ARG}
+};
+
+#define OPTABLE_SIZE (sizeof(optable) / sizeof(optable[0]))
+
+static uint32_t* image = NULL;  // the program, for instruction arguments
+static size_t image_size = 0;
+static int digits = 4;
+
+void read_image(char* path);
+uint32_t image_word(uint32_t address);
+void list_instruction(const TRACE_RECORD* record);
+
+
+/* main() - takes the trace file name and, optionally, the program image.
+*/
+int main(int argc, char *argv[])
+{
+    FILE* trace;
+    TRACE_HEADER header;
+    TRACE_RECORD record;
+    uint64_t first, i;
+
+    if (2 > argc)
+    {
+        puts("Usage: <tracefile> [<program>]");
+        return FAIL;
+    }
+    if (NULL == (trace = fopen(argv[1], "rb")))
+    {
+        puts("Trace file not found");
+        return FAIL;
+    }
+    if (1 != fread(&header, sizeof(header), 1, trace)
+        || 0 != memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic))
+        || sizeof(TRACE_RECORD) != header.record_size)
+    {
+        puts("Not a pmac trace file");
+        return FAIL;
+    }
+    if (2 < argc)
+        read_image(argv[2]);
+    digits = (32 == header.width) ? 8 : 4;
+
+    /* once the ring has wrapped, only the last 'capacity' records remain */
+    first = (header.count > header.capacity) ? header.count - header.capacity : 0;
+    printf("%llu instructions traced, %llu recorded\n\n",
+           (unsigned long long) header.count,
+           (unsigned long long) (header.count - first));
+
+    for (i = first; i < header.count; i++)
+    {
+        fseek(trace, sizeof(header) + (i % header.capacity) * sizeof(record), SEEK_SET);
+        if (1 != fread(&record, sizeof(record), 1, trace))
+            break;
+        list_instruction(&record);
+        printf("Registers: IP:%*x   SP:%*x   FP:%*x   TOS:%*x\n\n",
+               digits, record.ip, digits, record.sp,
+               digits, record.fp, digits, record.tos);
+    }
+    fclose(trace);
+    return SUCCEED;
+}
+
+
+/* read_image() - load the program words, skipping any header lines */
+void read_image(char* path)
+{
+    FILE* prog;
+    char line[64];
+    unsigned int value;
+    size_t allocated = 0;
+
+    if (NULL == (prog = fopen(path, "r")))
+    {
+        puts("Program file not found");
+        exit(FAIL);
+    }
+    while (NULL != fgets(line, sizeof(line), prog))
+    {
+        if ('.' == line[0] || 1 != sscanf(line, "%x", &value))
+            continue;
+        if (image_size == allocated)
+        {
+            allocated = allocated ? allocated * 2 : 1024;
+            if (NULL == (image = realloc(image, allocated * sizeof(uint32_t))))
+            {
+                puts("Out of memory");
+                exit(FAIL);
+            }
+        }
+        image[image_size++] = value;
+    }
+    fclose(prog);
+}
+
+
+uint32_t image_word(uint32_t address)
+{
+    return (address < image_size) ? image[address] : 0;
+}
+
+
+/* list_instruction() - print the instruction as display_program() does */
+void list_instruction(const TRACE_RECORD* record)
+{
+    size_t i;
+
+    for (i = 0; i < OPTABLE_SIZE && optable[i].op != record->op; i++)
+        ;
+    if (OPTABLE_SIZE == i)
+    {
+        printf("%*x: ???? %4x\n", digits, record->ip, record->op);
+        return;
+    }
+
+    printf("%*x: %s", digits, record->ip, optable[i].name);
+    if (NULL == image || NO_ARG == optable[i].args)
+        putchar('\n');
+    else if (IMMEDIATE == optable[i].args)
+        printf(" #%*x\n", digits, image_word(record->ip + 1));
+    else if (ADDRESS == optable[i].args)
+        printf(" %*x\n", digits, image_word(record->ip + 1));
+    else if (IMMEDIATE_BRANCH == optable[i].args)
+        printf(" #%*x %*x\n", digits, image_word(record->ip + 1),
+               digits, image_word(record->ip + 2));
+    else if (ADDRESS_BRANCH == optable[i].args)
+        printf(" %*x %*x\n", digits, image_word(record->ip + 1),
+               digits, image_word(record->ip + 2));
+    else
+        printf(" %*x[%*x]\n", digits, image_word(record->ip + 1),
+               digits, image_word(record->ip + 2));
+}
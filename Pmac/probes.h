@@ -0,0 +1,54 @@
+/* probes.h - static tracepoints for system tracers (see pmac.bt)
+ * version 00.01.00
+ * Copyright (C) 2011  Joseph Osako
+ * This file is part of Pmac-Passim.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef PROBES_H
+#define PROBES_H
+
+/* Where the host has <sys/sdt.h> (systemtap-sdt-dev, systemtap-sdt-devel)
+   each probe is a single NOP in the code, with a note in the executable
+   telling a tracer such as bpftrace where it is and where to find its
+   arguments. Without the header they compile to nothing at all.
+
+   pmac:start (width)                 a machine begins running
+   pmac:halt  (ip, retired)           it reaches HALT
+   pmac:bsr   (target, sp)            BSR, to the target
+   pmac:rts   (ip, sp)                RTS, back to the ip
+   pmac:in    (port, seek, value)     IN, with the word it pushed last
+   pmac:out   (port, seek, value)     OUT
+   pmac:fault (description, ip)       finish() with a failure
+*/
+#if defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define PMAC_PROBES
+#endif
+#endif
+
+#ifdef PMAC_PROBES
+#define PROBE1(name, a)         DTRACE_PROBE1(pmac, name, a)
+#define PROBE2(name, a, b)      DTRACE_PROBE2(pmac, name, a, b)
+#define PROBE3(name, a, b, c)   DTRACE_PROBE3(pmac, name, a, b, c)
+#else
+#define PROBE1(name, a)         ((void) 0)
+#define PROBE2(name, a, b)      ((void) 0)
+#define PROBE3(name, a, b, c)   ((void) 0)
+#endif
+
+#endif
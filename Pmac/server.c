@@ -0,0 +1,233 @@
+/* server.c - fork-server mode for pmac.
+ * 'pmac -f <program> <socket>' loads the program once and then waits
+ * for requests on a Unix socket. For each request the server forks, and
+ * the child runs the program in a copy-on-write copy of the loaded
+ * machine, so a request pays for neither the start of a process nor
+ * reading the image and setting up memory.
+ *
+ * A request passes three descriptors with SCM_RIGHTS: the TTY input,
+ * the TTY output and the disk image, opened for reading and writing.
+ * When the run is over the server answers with the exit status as a
+ * four-byte integer - that of exit(), or 128 plus the signal which
+ * ended the run - and closes the connection.
+ *
+ * 'pmac -q <socket> <diskimg>' makes one request with its own standard
+ * input and output and exits with the status of the run.
+ *
+ * version 00.01.00
+ * Copyright (C) 2011  Joseph Osako
+ * This file is part of Pmac-Passim.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include "pmac.h"
+#include "server.h"
+#include "smp.h"
+
+#define REQUEST_FDS 3       // TTY input, TTY output, disk image
+
+static int open_socket(char* socket_path, bool listening);
+static bool receive_request(int connection, int* fds);
+static void serve(int connection, int* fds);
+static void run_request(int* fds);
+
+
+/* server_run() - answer requests until the server is killed */
+void server_run(char* socket_path)
+{
+    struct sigaction action;
+    int listener, connection, fds[REQUEST_FDS], i;
+
+    /* the children answering requests are not waited for */
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = SIG_DFL;
+    action.sa_flags = SA_NOCLDWAIT;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGCHLD, &action, NULL);
+
+    listener = open_socket(socket_path, true);
+    printf("Serving %s\n", socket_path);
+    fflush(stdout);     // or the children would repeat it
+
+    for (;;)
+    {
+        if (0 > (connection = accept(listener, NULL, NULL)))
+            continue;
+        if (receive_request(connection, fds))
+        {
+            if (0 == fork())
+            {
+                close(listener);
+                serve(connection, fds);
+            }
+            for (i = 0; i < REQUEST_FDS; i++)
+                close(fds[i]);
+        }
+        close(connection);
+    }
+}
+
+
+/* server_request() - run the program in the server with this process's
+   TTY and the given disk image, and exit as the run did
+*/
+void server_request(char* socket_path, char* disk_path)
+{
+    int connection, fds[REQUEST_FDS];
+    int32_t status;
+    char byte = 0;
+    struct iovec data = {&byte, 1};
+    union
+    {
+        char buffer[CMSG_SPACE(sizeof(fds))];
+        struct cmsghdr align;
+    } control;
+    struct msghdr message;
+    struct cmsghdr* header;
+
+    fds[0] = STDIN_FILENO;
+    fds[1] = STDOUT_FILENO;
+    if (0 > (fds[2] = open(disk_path, O_RDWR)))
+        finish("Could not create disk image file", FAIL);
+    connection = open_socket(socket_path, false);
+
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = &data;
+    message.msg_iovlen = 1;
+    message.msg_control = control.buffer;
+    message.msg_controllen = sizeof(control.buffer);
+    header = CMSG_FIRSTHDR(&message);
+    header->cmsg_level = SOL_SOCKET;
+    header->cmsg_type = SCM_RIGHTS;
+    header->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(header), fds, sizeof(fds));
+
+    if (0 > sendmsg(connection, &message, 0))
+        finish("Could not send the request", FAIL);
+    if (sizeof(status) != recv(connection, &status, sizeof(status), MSG_WAITALL))
+        finish("No answer from the server", FAIL);
+    exit(status);
+}
+
+
+static int open_socket(char* socket_path, bool listening)
+{
+    struct sockaddr_un address;
+    int fd;
+
+    if (sizeof(address.sun_path) <= strlen(socket_path))
+        finish("Socket path too long", FAIL);
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, socket_path);
+
+    if (0 > (fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)))
+        finish("Could not create the socket", FAIL);
+    if (listening)
+    {
+        unlink(socket_path);
+        if (0 > bind(fd, (struct sockaddr*) &address, sizeof(address)) || 0 > listen(fd, 64))
+            finish("Could not listen on the socket", FAIL);
+    }
+    else if (0 > connect(fd, (struct sockaddr*) &address, sizeof(address)))
+        finish("Could not connect to the server", FAIL);
+    return fd;
+}
+
+
+static bool receive_request(int connection, int* fds)
+{
+    char byte;
+    struct iovec data = {&byte, 1};
+    union
+    {
+        char buffer[CMSG_SPACE(REQUEST_FDS * sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    struct msghdr message;
+    struct cmsghdr* header;
+
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = &data;
+    message.msg_iovlen = 1;
+    message.msg_control = control.buffer;
+    message.msg_controllen = sizeof(control.buffer);
+
+    if (0 >= recvmsg(connection, &message, MSG_CMSG_CLOEXEC))
+        return false;
+    header = CMSG_FIRSTHDR(&message);
+    if (NULL == header || SOL_SOCKET != header->cmsg_level || SCM_RIGHTS != header->cmsg_type
+        || CMSG_LEN(REQUEST_FDS * sizeof(int)) != header->cmsg_len)
+        return false;
+    memcpy(fds, CMSG_DATA(header), REQUEST_FDS * sizeof(int));
+    return true;
+}
+
+
+/* serve() - run the request in a child of its own, and answer with
+   how it ended
+*/
+static void serve(int connection, int* fds)
+{
+    struct sigaction action;
+    pid_t child;
+    int status;
+    int32_t answer;
+
+    /* this process does wait for its child */
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = SIG_DFL;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGCHLD, &action, NULL);
+
+    if (0 > (child = fork()))
+        _exit(FAIL);
+    if (0 == child)
+    {
+        close(connection);
+        run_request(fds);
+    }
+
+    waitpid(child, &status, 0);
+    answer = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    if (sizeof(answer) != write(connection, &answer, sizeof(answer)))
+        _exit(FAIL);
+    _exit(SUCCEED);
+}
+
+
+static void run_request(int* fds)
+{
+    if (0 > dup2(fds[0], STDIN_FILENO) || 0 > dup2(fds[1], STDOUT_FILENO))
+        _exit(FAIL);
+    if (NULL == (diskimg = fdopen(fds[2], "r+")))
+        _exit(FAIL);
+
+    if (1 < smp_cores)
+        smp_run();
+    else
+        run_machine();
+}
@@ -0,0 +1,228 @@
+/* shard.c - data-parallel runs of one program over a partitioned image.
+ * 'pmac -n <shards> <program> <diskimg>' loads the program once, cuts
+ * the disk image into that many ranges of records of about the same
+ * size, and forks a copy-on-write child of the loaded machine for each,
+ * all running at once. A shard's FDD seeks are taken from the start of
+ * its range, so a program written for a whole image works through its
+ * own part unchanged: a read past the end of the shard reads zero, as a
+ * read past the end of an image does, and a write there is a fault.
+ * '-u <records>' starts every shard on a multiple of that many records,
+ * so that a multi-word record is never split between shards.
+ *
+ * The shards have no TTY input. Each one's TTY output, along with its
+ * halting message and registers, is held in a temporary file and copied
+ * out in shard order once they have all finished, which concatenates the
+ * outputs. '-r <op>' also reduces the word each shard left on top of
+ * its stack when it halted, with add, min, max, and, ior or xor, and
+ * prints the result. With '-s', shard n writes its counters to
+ * <file>.n .
+ *
+ * version 00.01.00
+ * Copyright (C) 2011  Joseph Osako
+ * This file is part of Pmac-Passim.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "pmac.h"
+#include "io.h"
+#include "stats.h"
+#include "shard.h"
+
+#define PATH_SIZE  1024
+
+/* how each shard ended, in memory shared with the children */
+typedef struct
+{
+    bool reported;
+    EXITTYPE result;
+    uint32_t top;               // the word on top of its stack
+} OUTCOME;
+
+static const char* reducers[] = {"add", "min", "max", "and", "ior", "xor"};
+
+#define REDUCERS (sizeof(reducers) / sizeof(reducers[0]))
+
+int shard_count = 0;
+uint32_t shard_unit = 1;
+char* shard_disk = NULL;
+uint64_t shard_first = 0, shard_records = 0;
+
+static int reducer = -1;        // the index of the '-r' operation, if any
+static int shard = -1;          // the shard this process runs, in a child
+static OUTCOME* outcomes = NULL;
+
+static uint64_t boundary(int n, uint64_t records);
+static void run_shard(FILE* output);
+static uint32_t reduce(uint32_t left, uint32_t right);
+
+
+/* shard_reduce_by() - take the operation named with '-r' */
+void shard_reduce_by(char* name)
+{
+    for (reducer = 0; reducer < (int) REDUCERS && 0 != strcmp(reducers[reducer], name); reducer++)
+        ;
+    if ((int) REDUCERS == reducer)
+        finish("The reduction must be add, min, max, and, ior or xor", FAIL);
+}
+
+
+bool shard_active()
+{
+    return 0 <= shard;
+}
+
+
+/* shard_run() - run the loaded machine on every shard and report on
+   them in order. Exits with FAIL if any of them failed.
+*/
+void shard_run()
+{
+    FILE* outputs[MAX_SHARDS];
+    pid_t children[MAX_SHARDS];
+    EXITTYPE result = SUCCEED;
+    uint64_t records;
+    uint32_t total = 0;
+    bool any = false;
+    char buffer[4096];
+    size_t length;
+    int i, status;
+    bool ok;
+
+    if (0 != fseeko(diskimg, 0, SEEK_END))
+        finish("Could not size the disk image", FAIL);
+    records = ftello(diskimg) / DISK_RECORD;
+
+    outcomes = mmap(NULL, shard_count * sizeof(OUTCOME), PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (MAP_FAILED == outcomes)
+        finish("Could not share the shard results", FAIL);
+
+    fflush(stdout);     // or every child would print it again
+    for (i = 0; i < shard_count; i++)
+    {
+        if (NULL == (outputs[i] = tmpfile()))
+            finish("Could not hold the output of a shard", FAIL);
+        if (0 > (children[i] = fork()))
+            finish("Could not start a shard", FAIL);
+        if (0 == children[i])
+        {
+            shard = i;
+            shard_first = boundary(i, records);
+            shard_records = boundary(i + 1, records) - shard_first;
+            run_shard(outputs[i]);
+        }
+    }
+
+    for (i = 0; i < shard_count; i++)
+    {
+        waitpid(children[i], &status, 0);
+        rewind(outputs[i]);
+        while (0 < (length = fread(buffer, 1, sizeof(buffer), outputs[i])))
+            fwrite(buffer, 1, length, stdout);
+        fclose(outputs[i]);
+
+        ok = WIFEXITED(status) && SUCCEED == WEXITSTATUS(status) && outcomes[i].reported;
+        printf("Shard %d (records %llx to %llx): %s\n", i,
+               (unsigned long long) boundary(i, records),
+               (unsigned long long) boundary(i + 1, records),
+               ok ? "succeeded" : "failed");
+        if (!ok)
+            result = FAIL;
+        else if (0 <= reducer)
+        {
+            total = any ? reduce(total, outcomes[i].top) : outcomes[i].top;
+            any = true;
+        }
+    }
+    if (any)
+        printf(WIDE ? "Reduced by %s: %8x\n" : "Reduced by %s: %4x\n", reducers[reducer],
+               WIDE ? total : (uint16_t) total);
+    exit(result);
+}
+
+
+/* shard_report() - called from finish() in a shard, to leave the word
+   on top of its stack for the reduction
+*/
+void shard_report(EXITTYPE result)
+{
+    outcomes[shard].top = machine_top();
+    outcomes[shard].result = result;
+    outcomes[shard].reported = true;
+}
+
+
+/* boundary() - the first record of shard n, on a multiple of the unit */
+static uint64_t boundary(int n, uint64_t records)
+{
+    uint64_t units = (records + shard_unit - 1) / shard_unit;
+    uint64_t first = units * n / shard_count * shard_unit;
+
+    return (first < records) ? first : records;
+}
+
+
+/* run_shard() - in the child, point the TTY and the disk image at this
+   shard's own, and run
+*/
+static void run_shard(FILE* output)
+{
+    static char path[PATH_SIZE];
+    int none;
+
+    if (0 > (none = open("/dev/null", O_RDONLY)) || 0 > dup2(none, STDIN_FILENO)
+        || 0 > dup2(fileno(output), STDOUT_FILENO))
+        _exit(FAIL);
+    close(none);
+
+    /* the parent's stream shares its file offset with every child */
+    if (NULL == (diskimg = fopen(shard_disk, "r+")))
+        _exit(FAIL);
+    if (NULL != stats_path)
+    {
+        snprintf(path, PATH_SIZE, "%s.%d", stats_path, shard);
+        stats_path = path;
+    }
+    run_machine();
+}
+
+
+static uint32_t reduce(uint32_t left, uint32_t right)
+{
+    switch (reducer)
+    {
+        case 0:
+            return left + right;
+        case 1:
+            return (left < right) ? left : right;
+        case 2:
+            return (left > right) ? left : right;
+        case 3:
+            return left & right;
+        case 4:
+            return left | right;
+        default:
+            return left ^ right;
+    }
+}
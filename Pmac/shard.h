@@ -0,0 +1,42 @@
+/* shard.h
+ * version 00.01.00
+ * Copyright (C) 2011  Joseph Osako
+ * This file is part of Pmac-Passim.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SHARD_H
+#define SHARD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pmac.h"
+
+#define MAX_SHARDS  256
+
+extern int shard_count;         // 0 when the image is not sharded
+extern uint32_t shard_unit;     // shards start on multiples of this many records
+extern char* shard_disk;        // the image, for each shard to open for itself
+
+/* the records of the image the running machine sees, from its port 0 on */
+extern uint64_t shard_first, shard_records;
+
+void shard_reduce_by(char* name);
+bool shard_active(void);
+void shard_run(void);
+void shard_report(EXITTYPE result);
+
+#endif
@@ -0,0 +1,203 @@
+/* smp.c - shared-memory multiprocessing for pmac.
+ * 'pmac <program> <diskimg> -c <n>' runs the program on n cores which
+ * share the machine's memory. Every core starts at address 0 with its
+ * own registers and its own stack, CORE_STACK() words below the stack of
+ * the core before it, and runs on a host thread of its own; the main
+ * thread is core 0. CPUID and NCPU let a program divide the work.
+ *
+ * The memory model: each core sees its own loads and stores in program
+ * order. A word load or store is never torn, but there is no ordering
+ * between the plain loads and stores of different cores. CAS and AADD
+ * are atomic and sequentially consistent, and BARRIER waits until every
+ * running core has reached it - every store made before a BARRIER is
+ * seen by every load after it, on all cores. The TTY and FDD ports are
+ * shared, one transfer at a time.
+ *
+ * A core which halts drops out of the run (and out of the barriers); an
+ * error on any core ends the whole run.
+ *
+ * version 00.01.00
+ * Copyright (C) 2011  Joseph Osako
+ * This file is part of Pmac-Passim.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "pmac.h"
+#include "smp.h"
+#include "stats.h"
+#include "cache.h"
+
+int smp_cores = 1;
+
+static bool started = false;
+
+static _Thread_local unsigned core_id = 0;
+static MACHINE boot;                // core 0 as loaded
+static FILE* boot_disk;             // and the disk image all the cores share
+static CACHE* boot_cache;
+static pthread_t threads[MAX_CORES];
+
+/* the ports; recursive, as an error in a transfer ends in finish() */
+static pthread_mutex_t port_lock;
+
+/* the barrier */
+static pthread_mutex_t barrier_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t barrier_done = PTHREAD_COND_INITIALIZER;
+static unsigned live = 0, arrived = 0;
+static unsigned long generation = 0;
+
+static void* start_core(void* id);
+static void leave_barrier(void);
+
+
+/* smp_run() - start the other cores on the loaded machine, then run
+   core 0 on this thread.
+*/
+void smp_run()
+{
+    pthread_mutexattr_t attributes;
+    uintptr_t i;
+
+    pthread_mutexattr_init(&attributes);
+    pthread_mutexattr_settype(&attributes, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&port_lock, &attributes);
+
+    save_machine(&boot);
+    boot_disk = diskimg;
+    boot_cache = cache_current();
+    live = smp_cores;
+    started = true;
+    for (i = 1; i < (uintptr_t) smp_cores; i++)
+    {
+        if (0 != pthread_create(&threads[i], NULL, start_core, (void*) i))
+            finish("Could not start a core", FAIL);
+    }
+    start_core((void*) 0);
+}
+
+
+bool smp_active()
+{
+    return started;
+}
+
+
+static void* start_core(void* id)
+{
+    MACHINE m = boot;
+
+    core_id = (uintptr_t) id;
+    stats_core = &stats_cores[core_id];
+    diskimg = boot_disk;
+    cache_share(boot_cache);
+    m.top_reg = m.sp_reg = m.fp_reg = boot.sp_reg - core_id * CORE_STACK(boot.wide);
+    load_machine(&m);
+    run_machine();
+    return NULL;
+}
+
+
+/* smp_exit() - called by finish(), holding the port lock. A halted core
+   stops here, leaving the others running, except for core 0, which
+   waits for the rest so that finish() can close the run. On an error
+   the lock is kept and finish() ends the process.
+*/
+void smp_exit(EXITTYPE result)
+{
+    int i;
+
+    if (FAIL == result)
+        return;
+
+    leave_barrier();
+    smp_unlock();
+    if (0 != core_id)
+        pthread_exit(NULL);
+
+    for (i = 1; i < smp_cores; i++)
+        pthread_join(threads[i], NULL);
+    smp_lock();
+}
+
+
+unsigned smp_core()
+{
+    return core_id;
+}
+
+
+unsigned smp_count()
+{
+    return smp_cores;
+}
+
+
+/* smp_barrier() - wait until all the running cores have arrived */
+void smp_barrier()
+{
+    unsigned long round;
+
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (!smp_active())
+        return;
+
+    pthread_mutex_lock(&barrier_lock);
+    round = generation;
+    if (++arrived == live)
+    {
+        arrived = 0;
+        generation++;
+        pthread_cond_broadcast(&barrier_done);
+    }
+    else
+    {
+        while (round == generation)
+            pthread_cond_wait(&barrier_done, &barrier_lock);
+    }
+    pthread_mutex_unlock(&barrier_lock);
+}
+
+
+/* leave_barrier() - a halted core no longer holds up the others */
+static void leave_barrier()
+{
+    pthread_mutex_lock(&barrier_lock);
+    live--;
+    if (0 < arrived && arrived == live)
+    {
+        arrived = 0;
+        generation++;
+        pthread_cond_broadcast(&barrier_done);
+    }
+    pthread_mutex_unlock(&barrier_lock);
+}
+
+
+void smp_lock()
+{
+    if (smp_active())
+        pthread_mutex_lock(&port_lock);
+}
+
+
+void smp_unlock()
+{
+    if (smp_active())
+        pthread_mutex_unlock(&port_lock);
+}
@@ -0,0 +1,43 @@
+/* smp.h
+ * version 00.01.00
+ * Copyright (C) 2011  Joseph Osako
+ * This file is part of Pmac-Passim.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SMP_H
+#define SMP_H
+
+#include <stdbool.h>
+#include "pmac.h"
+
+#define MAX_CORES 16
+
+/* words of stack given to each core, below the stack of the one before */
+#define CORE_STACK(wide) ((wide) ? 0x100000 : 0x400)
+
+extern int smp_cores;   // cores asked for with '-c'
+
+void smp_run(void);
+bool smp_active(void);
+void smp_exit(EXITTYPE result);
+unsigned smp_core(void);
+unsigned smp_count(void);
+void smp_barrier(void);
+void smp_lock(void);
+void smp_unlock(void);
+
+#endif
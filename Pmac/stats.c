@@ -0,0 +1,235 @@
+/* stats.c - performance counters for pmac.
+ * The interpreter and the port backends bump the counters in 'stats'
+ * as they go. They are written out as JSON by finish() when '-s' names
+ * a file, and a SIGUSR1 writes a snapshot of them at any point of the
+ * run - to <file>.snapshot, or pmac-<pid>.json without '-s'. The signal
+ * handler only reads the counters and uses no stdio, so the snapshot
+ * does not disturb the running machine.
+ * version 00.01.00
+ * Copyright (C) 2011  Joseph Osako
+ * This file is part of Pmac-Passim.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include "pmac.h"
+#include "stats.h"
+
+#define STATS_TEXT 8192
+#define PATH_SIZE  1024
+
+STATS stats_cores[MAX_CORES];
+_Thread_local STATS* stats_core = &stats_cores[0];
+char* stats_path = NULL;
+
+static char snapshot_path[PATH_SIZE];
+
+/* names of the opcode classes of the instruction set */
+static const char* class_names[OPCODE_CLASSES] = {
+    [0x00] = "push",     [0x01] = "pop",      [0x02] = "branch",
+    [0x03] = "conditional", [0x04] = "call",  [0x05] = "compare",
+    [0x06] = "add",      [0x07] = "subtract", [0x08] = "multiply",
+    [0x09] = "divide",   [0x0A] = "shift_left", [0x0B] = "shift_right",
+    [0x0C] = "or",       [0x0D] = "xor",      [0x0E] = "and",
+    [0x0F] = "not",      [0x10] = "input",    [0x20] = "output",
+    [0x30] = "double",   [0x31] = "fixed",    [0x40] = "atomic",
+    [0x50] = "intrinsic", [0x60] = "heap"
+};
+
+static void snapshot(int signal);
+static int format_stats(char* text);
+static void sum_cores(STATS* total);
+static int add_text(char* text, int pos, const char* s);
+static int add_number(char* text, int pos, uint64_t n);
+static void write_file(const char* path);
+
+
+/* stats_init() - work out where snapshots go and install the handler */
+void stats_init()
+{
+    struct sigaction action;
+
+    if (NULL != stats_path)
+        snprintf(snapshot_path, PATH_SIZE, "%s.snapshot", stats_path);
+    else
+        snprintf(snapshot_path, PATH_SIZE, "pmac-%ld.json", (long) getpid());
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = snapshot;
+    action.sa_flags = SA_RESTART;   // a snapshot must not break a TTY read
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGUSR1, &action, NULL);
+}
+
+
+/* stats_write() - write the final counters, if they were asked for */
+void stats_write()
+{
+    if (NULL != stats_path)
+        write_file(stats_path);
+}
+
+
+static void snapshot(int signal)
+{
+    (void) signal;
+    write_file(snapshot_path);
+}
+
+
+/* write_file() - async-signal-safe, as it also serves the handler */
+static void write_file(const char* path)
+{
+    char text[STATS_TEXT];
+    int fd, length;
+
+    length = format_stats(text);
+    if (0 > (fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644)))
+        return;
+    if (length != write(fd, text, length))
+        length = 0;     // nothing more to be done about it here
+    close(fd);
+}
+
+
+static int format_stats(char* text)
+{
+    int pos = 0, i;
+    char name[8];
+    const char* hex = "0123456789abcdef";
+    STATS total;
+
+    sum_cores(&total);
+
+    pos = add_text(text, pos, "{\n  \"width\": ");
+    pos = add_number(text, pos, WIDE ? 32 : 16);
+    pos = add_text(text, pos, ",\n  \"instructions_retired\": ");
+    pos = add_number(text, pos, total.retired);
+    pos = add_text(text, pos, ",\n  \"opcode_classes\": {");
+    for (i = 0; i < OPCODE_CLASSES; i++)
+    {
+        /* named classes are always listed, others only once used */
+        if (NULL == class_names[i] && 0 == total.classes[i])
+            continue;
+        if (NULL == class_names[i])
+        {
+            name[0] = '0';
+            name[1] = 'x';
+            name[2] = hex[i >> 4];
+            name[3] = hex[i & 0xF];
+            name[4] = '\0';
+        }
+        pos = add_text(text, pos, (0 < i) ? ",\n    \"" : "\n    \"");
+        pos = add_text(text, pos, (NULL != class_names[i]) ? class_names[i] : name);
+        pos = add_text(text, pos, "\": ");
+        pos = add_number(text, pos, total.classes[i]);
+    }
+    pos = add_text(text, pos, "\n  },\n  \"branches_taken\": ");
+    pos = add_number(text, pos, total.branches);
+    pos = add_text(text, pos, ",\n  \"stack_high_water\": ");
+    pos = add_number(text, pos, total.stack_depth);
+    pos = add_text(text, pos, ",\n  \"tty_reads\": ");
+    pos = add_number(text, pos, total.tty_reads);
+    pos = add_text(text, pos, ",\n  \"tty_writes\": ");
+    pos = add_number(text, pos, total.tty_writes);
+    pos = add_text(text, pos, ",\n  \"fdd_reads\": ");
+    pos = add_number(text, pos, total.fdd_reads);
+    pos = add_text(text, pos, ",\n  \"fdd_writes\": ");
+    pos = add_number(text, pos, total.fdd_writes);
+    pos = add_text(text, pos, ",\n  \"bytes_in\": ");
+    pos = add_number(text, pos, total.bytes_in);
+    pos = add_text(text, pos, ",\n  \"bytes_out\": ");
+    pos = add_number(text, pos, total.bytes_out);
+    pos = add_text(text, pos, ",\n  \"heap\": {\n    \"allocations\": ");
+    pos = add_number(text, pos, total.heap_allocs);
+    pos = add_text(text, pos, ",\n    \"frees\": ");
+    pos = add_number(text, pos, total.heap_frees);
+    pos = add_text(text, pos, ",\n    \"resizes\": ");
+    pos = add_number(text, pos, total.heap_resizes);
+    pos = add_text(text, pos, ",\n    \"failures\": ");
+    pos = add_number(text, pos, total.heap_failures);
+    pos = add_text(text, pos, ",\n    \"words_in_use\": ");
+    pos = add_number(text, pos, total.heap_words);
+    pos = add_text(text, pos, ",\n    \"high_water\": ");
+    pos = add_number(text, pos, total.heap_high_water);
+    pos = add_text(text, pos, "\n  }");
+    pos = add_text(text, pos, "\n}\n");
+    return pos;
+}
+
+
+/* sum_cores() - add up the counters of all the cores; the deepest
+   stack is the deepest of any one core's.
+*/
+static void sum_cores(STATS* total)
+{
+    const STATS* core;
+    int i, c;
+
+    memset(total, 0, sizeof(STATS));
+    for (c = 0; c < MAX_CORES; c++)
+    {
+        core = &stats_cores[c];
+        total->retired += core->retired;
+        for (i = 0; i < OPCODE_CLASSES; i++)
+            total->classes[i] += core->classes[i];
+        total->branches += core->branches;
+        if (core->stack_depth > total->stack_depth)
+            total->stack_depth = core->stack_depth;
+        total->tty_reads += core->tty_reads;
+        total->tty_writes += core->tty_writes;
+        total->fdd_reads += core->fdd_reads;
+        total->fdd_writes += core->fdd_writes;
+        total->bytes_in += core->bytes_in;
+        total->bytes_out += core->bytes_out;
+        total->heap_allocs += core->heap_allocs;
+        total->heap_frees += core->heap_frees;
+        total->heap_resizes += core->heap_resizes;
+        total->heap_failures += core->heap_failures;
+        total->heap_words += core->heap_words;     // a core may free what another allocated
+        if (core->heap_high_water > total->heap_high_water)
+            total->heap_high_water = core->heap_high_water;
+    }
+}
+
+
+static int add_text(char* text, int pos, const char* s)
+{
+    while ('\0' != *s && pos < STATS_TEXT)
+        text[pos++] = *s++;
+    return pos;
+}
+
+
+static int add_number(char* text, int pos, uint64_t n)
+{
+    char digits[24];
+    int i = 0;
+
+    do
+    {
+        digits[i++] = '0' + n % 10;
+        n /= 10;
+    } while (0 < n);
+
+    while (0 < i && pos < STATS_TEXT)
+        text[pos++] = digits[--i];
+    return pos;
+}
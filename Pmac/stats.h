@@ -0,0 +1,54 @@
+/* stats.h
+ * version 00.01.00
+ * Copyright (C) 2011  Joseph Osako
+ * This file is part of Pmac-Passim.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+#include "smp.h"
+
+/* opcodes are counted by class, the high byte of the opcode */
+#define OPCODE_CLASSES 256
+
+typedef struct
+{
+    uint64_t retired;                   // instructions executed
+    uint64_t classes[OPCODE_CLASSES];   // instructions by opcode class
+    uint64_t branches;                  // branches, calls and returns taken
+    uint64_t stack_depth;               // deepest the stack has been, in words
+    uint64_t tty_reads, tty_writes;
+    uint64_t fdd_reads, fdd_writes;
+    uint64_t bytes_in, bytes_out;       // data moved through the ports
+    uint64_t heap_allocs, heap_frees, heap_resizes;
+    uint64_t heap_failures;             // allocations there was no room for
+    uint64_t heap_words;                // words in allocated blocks
+    uint64_t heap_high_water;           // most of the heap ever handed out
+} __attribute__((aligned(64))) STATS;
+
+/* each core of an SMP run counts into its own set, summed for the report */
+extern STATS stats_cores[];
+extern _Thread_local STATS* stats_core;     // the set of the core on this thread
+#define stats (*stats_core)
+extern char* stats_path;
+
+void stats_init(void);
+void stats_write(void);
+
+#endif
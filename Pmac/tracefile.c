@@ -0,0 +1,74 @@
+/* tracefile.c - binary execution traces for pmac.
+ * With '-b <file>', every instruction appends a fixed-size record of
+ * the registers to a ring buffer memory-mapped from <file>, which keeps
+ * the cost close to that of the interpreter itself. pmtrace decodes the
+ * file into a listing afterwards.
+ * version 00.01.00
+ * Copyright (C) 2011  Joseph Osako
+ * This file is part of Pmac-Passim.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include "pmac.h"
+#include "tracefile.h"
+
+#define TRACE_SIZE (sizeof(TRACE_HEADER) + TRACE_RECORDS * sizeof(TRACE_RECORD))
+
+TRACE_HEADER* trace_header = NULL;
+TRACE_RECORD* trace_ring = NULL;
+
+
+/* tracefile_open() - create the trace file and map it. The file is
+   sparse, so only the part of the ring actually used takes up space.
+*/
+void tracefile_open(char* path)
+{
+    int fd;
+    void* region;
+
+    if (0 > (fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644)))
+        finish("Could not create trace file", FAIL);
+    if (0 != ftruncate(fd, TRACE_SIZE))
+        finish("Could not create trace file", FAIL);
+    region = mmap(NULL, TRACE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (MAP_FAILED == region)
+        finish("Could not map trace file", FAIL);
+
+    trace_header = region;
+    trace_ring = (TRACE_RECORD*) (trace_header + 1);
+    memcpy(trace_header->magic, TRACE_MAGIC, sizeof(trace_header->magic));
+    trace_header->width = WIDE ? 32 : 16;
+    trace_header->record_size = sizeof(TRACE_RECORD);
+    trace_header->capacity = TRACE_RECORDS;
+    trace_header->count = 0;
+}
+
+
+void tracefile_close()
+{
+    if (NULL == trace_header)
+        return;
+    msync(trace_header, TRACE_SIZE, MS_SYNC);
+    munmap(trace_header, TRACE_SIZE);
+    trace_header = NULL;
+    trace_ring = NULL;
+}
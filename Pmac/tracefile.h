@@ -0,0 +1,74 @@
+/* tracefile.h
+ * version 00.01.00
+ * Copyright (C) 2011  Joseph Osako
+ * This file is part of Pmac-Passim.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef TRACEFILE_H
+#define TRACEFILE_H
+
+#include <stdint.h>
+
+/* A binary trace is a header followed by a ring of fixed-size records,
+   one per instruction, holding the registers as the instruction starts.
+   Once 'count' passes 'capacity' the oldest records are overwritten. */
+
+#define TRACE_MAGIC    "PMACTRC1"
+#define TRACE_RECORDS  (1 << 22)    // capacity of the ring, a power of two
+
+typedef struct
+{
+    char magic[8];
+    uint32_t width;             // 16 or 32
+    uint32_t record_size;
+    uint64_t capacity;          // records in the ring
+    uint64_t count;             // records written since the start
+} TRACE_HEADER;
+
+typedef struct
+{
+    uint32_t ip, op, sp, fp, tos;
+} TRACE_RECORD;
+
+extern TRACE_HEADER* trace_header;
+extern TRACE_RECORD* trace_ring;
+
+void tracefile_open(char* path);
+void tracefile_close(void);
+
+/* trace_record() - append one record; called once per instruction */
+static inline void trace_record(uint32_t ip, uint32_t op, uint32_t sp,
+                                uint32_t fp, uint32_t tos)
+{
+    TRACE_RECORD* record;
+
+    record = &trace_ring[trace_header->count++ & (TRACE_RECORDS - 1)];
+    record->ip = ip;
+    record->op = op;
+    record->sp = sp;
+    record->fp = fp;
+    record->tos = tos;
+}
+
+/* trace_amend() - give the last record another opcode, for a breakpoint
+   whose record should show the instruction it covers */
+static inline void trace_amend(uint32_t op)
+{
+    trace_ring[(trace_header->count - 1) & (TRACE_RECORDS - 1)].op = op;
+}
+
+#endif